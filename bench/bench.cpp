@@ -7,6 +7,7 @@
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 using namespace MySpace;
 
@@ -105,7 +106,7 @@ void scenario3_asyncLogging() {
     std::cout << YELLOW << "平均每条: " << duration.count() / 100.0 << " μs" << RESET << std::endl;
     
     // 等待异步日志器处理完成
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    async_logger->flush();
 }
 
 // ═══════════════════════════════════════════════
@@ -200,7 +201,7 @@ void performanceComparison() {
         sync_logger->info(__FILE__, __LINE__, "性能测试消息");
     }
     auto end = std::chrono::high_resolution_clock::now();
-    auto sync_duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    auto sync_duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
     
     // 异步日志器性能测试
     printInfo("测试异步日志器性能...");
@@ -218,22 +219,25 @@ void performanceComparison() {
     for (int i = 0; i < TEST_COUNT; ++i) {
         async_logger->info(__FILE__, __LINE__, "性能测试消息");
     }
+    // 等待异步日志处理完成（flush 返回时数据已写入文件），计时包含后台落地
+    async_logger->flush(std::chrono::seconds(10));
     end = std::chrono::high_resolution_clock::now();
-    auto async_duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    
-    // 等待异步日志处理完成
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    auto async_duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
     
     // 输出结果
     std::cout << "\n" << BOLD << "性能测试结果（" << TEST_COUNT << "条日志）：" << RESET << std::endl;
     std::cout << "─────────────────────────────────────" << std::endl;
-    std::cout << "同步日志器: " << YELLOW << std::setw(6) << sync_duration.count() << " ms" << RESET;
-    std::cout << "  (" << (double)TEST_COUNT / sync_duration.count() * 1000 << " 条/秒)" << std::endl;
-    std::cout << "异步日志器: " << GREEN << std::setw(6) << async_duration.count() << " ms" << RESET;
-    std::cout << "  (" << (double)TEST_COUNT / async_duration.count() * 1000 << " 条/秒)" << std::endl;
+    // 微秒计时，至少按 1μs 计算，避免除零
+    double sync_us = std::max<double>(sync_duration.count(), 1);
+    double async_us = std::max<double>(async_duration.count(), 1);
+    std::cout << "同步日志器: " << YELLOW << std::setw(8) << sync_us << " μs" << RESET;
+    std::cout << "  (" << (double)TEST_COUNT / sync_us * 1000000 << " 条/秒)" << std::endl;
+    std::cout << "异步日志器: " << GREEN << std::setw(8) << async_us << " μs" << RESET;
+    std::cout << "  (" << (double)TEST_COUNT / async_us * 1000000 << " 条/秒)" << std::endl;
     std::cout << "─────────────────────────────────────" << std::endl;
+    std::cout << "更完整的多线程/延迟分布测试见 log_bench（输出 JSON）" << std::endl;
     
-    double speedup = (double)sync_duration.count() / async_duration.count();
+    double speedup = sync_us / async_us;
     std::cout << BOLD << GREEN << "性能提升: " << std::fixed << std::setprecision(1) 
               << speedup << "x" << RESET << std::endl;
 }
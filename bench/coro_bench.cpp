@@ -0,0 +1,168 @@
+// coro_bench.cpp - 协程接口（logs/coro.hpp）与阻塞接口的对比，需要 C++20（-DLOG_ENABLE_COROUTINES=ON）
+// 一个单线程执行器上跑若干个写日志的协程和一个心跳协程，落地方向每批故意慢一些，让生产缓冲区写满：
+//   blocking：协程里直接调用 logger->logAt，缓冲区满时整个执行器线程阻塞，心跳跟着停住
+//   await   ：co_await logAsync，缓冲区满时只挂起写日志的协程，心跳照常运行
+// 输出总耗时、写出的条数、心跳次数和最大心跳间隔，以及协程挂起次数。
+//
+// 用法：coro_bench [协程数] [每个协程的条数] [落地每批耗时(us)]
+
+#include "../logs/coro.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <thread>
+
+using namespace MySpace;
+
+// 单线程执行器：post 可以在任意线程调用，run 在当前线程依次恢复协程，直到所有任务结束
+class Executor {
+    public:
+        void post(std::coroutine_handle<> h) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _ready.push_back(h);
+            _cond.notify_one();
+        }
+        void started() { ++_live; }
+        void finished() { --_live; }
+        void run() {
+            while (true) {
+                std::coroutine_handle<> h;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _cond.wait(lock, [&]() { return !_ready.empty() || _live == 0; });
+                    if (_ready.empty()) return;
+                    h = _ready.front();
+                    _ready.pop_front();
+                }
+                h.resume();
+            }
+        }
+    private:
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::deque<std::coroutine_handle<>> _ready;
+        std::atomic<size_t> _live{0};   // 尚未结束的任务数，只在执行器线程中修改
+};
+
+// 即发即忘的任务：创建后挂起，由执行器第一次恢复
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> handle;
+};
+
+static void spawn(Executor &exec, Task task) {
+    exec.started();
+    exec.post(task.handle);
+}
+
+// 让出执行器
+struct Yield {
+    Executor &exec;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { exec.post(h); }
+    void await_resume() const noexcept {}
+};
+
+// 每批都睡一会儿的落地方向，模拟慢磁盘
+class SlowSink : public LogSink {
+    public:
+        explicit SlowSink(size_t batch_us) : _batch_us(batch_us) {}
+        void log(const char *data, size_t len) override { (void)data; _bytes += len; }
+        void logRecords(Buffer &buf, LogLevel::value min_level) override {
+            LogSink::logRecords(buf, min_level);
+            _records += buf.recordCount();
+            std::this_thread::sleep_for(std::chrono::microseconds(_batch_us));
+        }
+        size_t records() const { return _records; }
+    private:
+        size_t _batch_us;
+        size_t _bytes = 0;
+        size_t _records = 0;
+};
+
+static uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Result {
+    uint64_t total_us = 0;
+    size_t heartbeats = 0;
+    uint64_t max_gap_us = 0;
+};
+
+static Task producer(Executor &exec, std::shared_ptr<Logger> logger, size_t count, bool await, const std::string &payload
+    , size_t &remaining) {
+    for (size_t i = 0; i < count; ++i) {
+        if (await) co_await logAsync(*logger, exec, LogLevel::INFO, __FILE__, __LINE__, payload);
+        else logger->logAt(LogLevel::INFO, __FILE__, __LINE__, payload);
+        // 每写一批让出一次，给其他协程机会
+        if (i % 64 == 63) co_await Yield{exec};
+    }
+    co_await flushAsync(*logger, exec);
+    remaining--;
+    exec.finished();
+}
+
+static Task heartbeat(Executor &exec, Result &result, const bool &done) {
+    uint64_t last = nowUs();
+    while (!done) {
+        co_await Yield{exec};
+        uint64_t now = nowUs();
+        if (now - last > result.max_gap_us) result.max_gap_us = now - last;
+        last = now;
+        result.heartbeats++;
+        std::this_thread::sleep_for(std::chrono::microseconds(50));   // 心跳之间的其他工作
+    }
+    exec.finished();
+}
+
+// 所有写日志的协程结束后通知心跳退出
+static Task waiter(Executor &exec, const size_t &remaining, bool &done) {
+    while (remaining > 0) co_await Yield{exec};
+    done = true;
+    exec.finished();
+}
+
+static Result run(bool await, size_t coros, size_t count, size_t batch_us, size_t &written, uint64_t &suspends) {
+    auto sink = std::make_shared<SlowSink>(batch_us);
+    auto logger = LoggerFactory::createAsynchLogger(await ? "coro-await" : "coro-blocking", LogLevel::DEBUG, "%m%n", {sink});
+    std::string payload(200, 'x');
+    Executor exec;
+    Result result;
+    bool done = false;
+    size_t remaining = coros;
+    uint64_t begin = nowUs();
+    for (size_t i = 0; i < coros; ++i)
+        spawn(exec, producer(exec, logger, count, await, payload, remaining));
+    spawn(exec, heartbeat(exec, result, done));
+    spawn(exec, waiter(exec, remaining, done));
+    exec.run();
+    result.total_us = nowUs() - begin;
+    logger->flush();
+    written = sink->records();
+    suspends = logger->stats().producer_waits;
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    size_t coros = argc > 1 ? strtoul(argv[1], nullptr, 10) : 8;
+    size_t count = argc > 2 ? strtoul(argv[2], nullptr, 10) : 50000;
+    size_t batch_us = argc > 3 ? strtoul(argv[3], nullptr, 10) : 20000;
+    printf("%-10s %10s %10s %12s %16s %12s\n", "mode", "time(ms)", "records", "heartbeats", "max_gap(ms)", "waits");
+    for (bool await : {false, true}) {
+        size_t written = 0;
+        uint64_t suspends = 0;
+        Result r = run(await, coros, count, batch_us, written, suspends);
+        printf("%-10s %10.1f %10zu %12zu %16.1f %12llu\n", await ? "await" : "blocking", r.total_us / 1000.0, written,
+            r.heartbeats, r.max_gap_us / 1000.0, (unsigned long long)suspends);
+    }
+    return 0;
+}
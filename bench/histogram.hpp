@@ -0,0 +1,66 @@
+// histogram.hpp - 基准测试用的 HDR 风格延迟直方图
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+/*
+    对数-线性分桶：每个 2 的幂区间再均分为 2^SUB_BITS 个子桶，相对误差约 1/2^SUB_BITS（约 3%），
+    记录一次只需要一次 clz 和一次数组自增，适合在每次日志调用后记录延迟。
+*/
+class LatencyHistogram {
+    public:
+        static const int SUB_BITS = 5;
+        static const int SUB_COUNT = 1 << SUB_BITS;
+        static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+        LatencyHistogram() { reset(); }
+        void reset() {
+            memset(_counts, 0, sizeof(_counts));
+            _total = 0;
+            _max = 0;
+        }
+        void record(uint64_t value) {
+            _counts[index(value)]++;
+            _total++;
+            if (value > _max) _max = value;
+        }
+        // 合并另一个直方图（各线程各记一份，结束后合并）
+        void merge(const LatencyHistogram &other) {
+            for (int i = 0; i < BUCKETS; ++i) _counts[i] += other._counts[i];
+            _total += other._total;
+            _max = std::max(_max, other._max);
+        }
+        // 百分位数，q 取值 [0, 1]，返回所在桶的下界
+        uint64_t percentile(double q) const {
+            if (_total == 0) return 0;
+            uint64_t rank = (uint64_t)(q * (double)(_total - 1)) + 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < BUCKETS; ++i) {
+                seen += _counts[i];
+                if (seen >= rank) return std::min(lowerBound(i), _max);
+            }
+            return _max;
+        }
+        uint64_t max() const { return _max; }
+        uint64_t count() const { return _total; }
+    private:
+        static int index(uint64_t v) {
+            if (v < (uint64_t)SUB_COUNT) return (int)v;
+            int e = 63 - __builtin_clzll(v);           // v 的最高位
+            int bucket = e - SUB_BITS + 1;
+            int sub = (int)((v >> (e - SUB_BITS)) - SUB_COUNT);
+            return bucket * SUB_COUNT + sub;
+        }
+        static uint64_t lowerBound(int idx) {
+            if (idx < SUB_COUNT) return (uint64_t)idx;
+            int bucket = idx / SUB_COUNT;
+            int sub = idx % SUB_COUNT;
+            int e = bucket + SUB_BITS - 1;
+            return (uint64_t)(SUB_COUNT + sub) << (e - SUB_BITS);
+        }
+    private:
+        uint64_t _counts[BUCKETS];
+        uint64_t _total;
+        uint64_t _max;
+};
@@ -0,0 +1,194 @@
+// log_bench.cpp - 日志系统基准测试套件
+// 在 线程数 × 消息大小 × 落地方向 × 同步/异步 的组合上测量：
+//   1. 完成时间：从第一条日志开始，到 flush() 返回（数据全部落地）为止
+//   2. 单次调用延迟分布：p50 / p99 / p99.9 / max（HDR 风格直方图）
+// 结果以 JSON 输出，便于不同构建之间对比、发现性能回退。
+// flush() 在时限内没有完成的组合，完成时间没有意义：结果中 "flushed" 为 false，程序最后以 2 退出。
+//
+// 模式：sync / async 为所有线程共用一个日志器；merge / ordered 为每个线程一个异步日志器，
+//       合并写同一个落地方向（SharedSink / 按时间重排的 OrderedSink），用来衡量有序合并的代价。
+//
+// 用法：log_bench [--threads 1,4,16] [--sizes 16,256] [--sinks null,file,direct] [--modes sync,async,merge,ordered]
+//                 [--messages N] [--out result.json]
+
+#include "../logs/logger.hpp"
+#include "histogram.hpp"
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace MySpace;
+
+// 什么都不做的落地方向，用来测量日志器自身的开销
+class NullSink : public LogSink {
+    public:
+        void log(const char *, size_t) override {}
+        bool concurrentSafe() const override { return true; }
+};
+
+struct BenchCase {
+    std::string mode;       // sync / async / merge / ordered
+    std::string sink;       // null / file / direct（FileSink 直接追加模式）
+    size_t threads;
+    size_t msg_size;
+    size_t messages;        // 所有线程合计的日志条数
+};
+
+struct BenchResult {
+    BenchCase c;
+    double total_ns;        // 含 flush 的完成时间
+    bool flushed;           // flush() 是否在时限内完成
+    LatencyHistogram hist;
+};
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::vector<std::string> split(const std::string &s) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) if (!item.empty()) out.push_back(item);
+    return out;
+}
+
+static std::vector<size_t> splitNum(const std::string &s) {
+    std::vector<size_t> out;
+    for (auto &item : split(s)) out.push_back(std::stoul(item));
+    return out;
+}
+
+static std::shared_ptr<LogSink> makeSink(const BenchCase &c) {
+    std::shared_ptr<LogSink> sink;
+    if (c.sink == "file" || c.sink == "direct") {
+        std::string path = "./bench_logs/" + c.mode + ".log";
+        remove(path.c_str());
+        sink = std::make_shared<FileSink>(path, c.sink == "direct");
+    } else {
+        sink = std::make_shared<NullSink>();
+    }
+    // 多个日志器合并写同一个目的地
+    if (c.mode == "merge") return std::make_shared<SharedSink>(sink);
+    if (c.mode == "ordered") return std::make_shared<OrderedSink>(sink);
+    return sink;
+}
+
+static std::shared_ptr<Logger> makeLogger(const BenchCase &c, std::shared_ptr<LogSink> sink, size_t index) {
+    const std::string pattern = "[%d{%H:%M:%S}][%t][%c][%f:%l][%p]%T%m%n";
+    if (c.mode == "sync")
+        return LoggerFactory::createSynchLogger("bench", LogLevel::DEBUG, pattern, {sink});
+    return LoggerFactory::createAsynchLogger("bench" + std::to_string(index), LogLevel::DEBUG, pattern, {sink});
+}
+
+static BenchResult runCase(const BenchCase &c) {
+    BenchResult r;
+    r.c = c;
+    auto sink = makeSink(c);
+    bool per_thread_logger = c.mode == "merge" || c.mode == "ordered";
+    std::vector<std::shared_ptr<Logger>> loggers;
+    for (size_t t = 0; t < (per_thread_logger ? c.threads : 1); ++t)
+        loggers.push_back(makeLogger(c, sink, t));
+    std::string msg(c.msg_size, 'x');
+    size_t per_thread = c.messages / c.threads;
+    std::vector<LatencyHistogram> hists(c.threads);
+    std::vector<std::thread> workers;
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false);
+
+    for (size_t t = 0; t < c.threads; ++t) {
+        workers.emplace_back([&, t]() {
+            LatencyHistogram &h = hists[t];
+            Logger *logger = loggers[per_thread_logger ? t : 0].get();
+            ready++;
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (size_t i = 0; i < per_thread; ++i) {
+                uint64_t begin = nowNs();
+                logger->info(__FILE__, __LINE__, msg);
+                h.record(nowNs() - begin);
+            }
+        });
+    }
+    while (ready.load() < c.threads) std::this_thread::yield();
+    uint64_t start = nowNs();
+    go.store(true, std::memory_order_release);
+    for (auto &w : workers) w.join();
+    r.flushed = true;
+    for (auto &logger : loggers)                    // 完成时间包含后台落地
+        if (!logger->flush(std::chrono::seconds(60))) r.flushed = false;
+    if (per_thread_logger) sink->flush();
+    r.total_ns = (double)(nowNs() - start);
+
+    for (auto &h : hists) r.hist.merge(h);
+    r.c.messages = per_thread * c.threads;
+    return r;
+}
+
+static void writeJson(std::ostream &out, const std::vector<BenchResult> &results) {
+    out << "{\n  \"benchmark\": \"log_bench\",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r = results[i];
+        double secs = r.total_ns / 1e9;
+        char line[1024];
+        snprintf(line, sizeof(line),
+            "    {\"mode\": \"%s\", \"sink\": \"%s\", \"threads\": %zu, \"msg_size\": %zu, \"messages\": %zu, "
+            "\"flushed\": %s, \"total_ms\": %.3f, \"msgs_per_sec\": %.0f, \"mb_per_sec\": %.2f, "
+            "\"latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}}%s\n",
+            r.c.mode.c_str(), r.c.sink.c_str(), r.c.threads, r.c.msg_size, r.c.messages,
+            r.flushed ? "true" : "false", r.total_ns / 1e6, r.c.messages / secs, r.c.messages * (double)r.c.msg_size / secs / (1024 * 1024),
+            (unsigned long long)r.hist.percentile(0.50), (unsigned long long)r.hist.percentile(0.99),
+            (unsigned long long)r.hist.percentile(0.999), (unsigned long long)r.hist.max(),
+            i + 1 == results.size() ? "" : ",");
+        out << line;
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<size_t> threads = {1, 2, 4, 8, 16, 32, 64};
+    std::vector<size_t> sizes = {16, 128, 1024};
+    std::vector<std::string> sinks = {"null", "file"};
+    std::vector<std::string> modes = {"sync", "async", "merge", "ordered"};
+    size_t messages = 200000;
+    std::string out_path;
+
+    for (int i = 1; i < argc; i += 2) {
+        std::string key = argv[i];
+        if (i + 1 == argc) { std::cerr << "参数缺少取值: " << key << std::endl; return 1; }
+        std::string val = argv[i + 1];
+        if (key == "--threads") threads = splitNum(val);
+        else if (key == "--sizes") sizes = splitNum(val);
+        else if (key == "--sinks") sinks = split(val);
+        else if (key == "--modes") modes = split(val);
+        else if (key == "--messages") messages = std::stoul(val);
+        else if (key == "--out") out_path = val;
+        else { std::cerr << "未知参数: " << key << std::endl; return 1; }
+    }
+
+    std::vector<BenchResult> results;
+    for (auto &mode : modes)
+        for (auto &sink : sinks)
+            for (size_t size : sizes)
+                for (size_t t : threads) {
+                    BenchCase c{mode, sink, t, size, messages};
+                    results.push_back(runCase(c));
+                    std::cerr << mode << "/" << sink << " threads=" << t << " size=" << size
+                              << (results.back().flushed ? " done" : " flush timed out") << std::endl;
+                }
+
+    if (out_path.empty()) {
+        writeJson(std::cout, results);
+    } else {
+        std::ofstream ofs(out_path);
+        writeJson(ofs, results);
+    }
+    for (auto &r : results)
+        if (!r.flushed) return 2;
+    return 0;
+}
@@ -0,0 +1,215 @@
+// micro_bench.cpp - 日志流水线各阶段的微基准测试
+// 单独测量每个环节：各格式化子项、LogMsg 构造、Buffer::push / 按块增长、
+// AsynchLooper 的 push/交换循环（空回调）、各落地方向写 /dev/null 或 tmpfs、Simd 扫描内核。
+// 每项输出 ns/op、allocs/op（通过替换全局 operator new 统计）和 bytes/op。
+// 端到端数据（log_bench）变化时，用它定位是哪个环节引起的。
+//
+// 用法：micro_bench [过滤子串]
+
+#include "../logs/logger.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <unistd.h>
+
+using namespace MySpace;
+
+// ═══════════════════════════════════════════════
+// 全局 operator new 钩子：统计分配次数和字节数
+// ═══════════════════════════════════════════════
+static std::atomic<uint64_t> g_allocs(0);
+static std::atomic<uint64_t> g_alloc_bytes(0);
+
+void *operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+// 超过默认对齐的类型（如 alignas(32) 的 RecordMeta）走带 align_val_t 的版本，同样要计数
+void *operator new(size_t size, std::align_val_t align) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    size_t a = std::max((size_t)align, sizeof(void *));
+    void *p = nullptr;
+    if (posix_memalign(&p, a, size ? size : 1) == 0) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size, std::align_val_t align) { return operator new(size, align); }
+// delete 不内联：内联后 GCC 会把 free 和调用处的 new 表达式配对，误报 -Wmismatched-new-delete
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p, size_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, std::align_val_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p, std::align_val_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t, std::align_val_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p, size_t, std::align_val_t) noexcept { free(p); }
+
+// 阻止编译器把被测代码优化掉
+template<class T>
+static void doNotOptimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static const char *g_filter = nullptr;
+
+// 先预热 iters/10 次，再计时 iters 次
+template<class F>
+static void bench(const char *name, size_t iters, F &&fn) {
+    if (g_filter && !strstr(name, g_filter)) return;
+    for (size_t i = 0; i < iters / 10; ++i) fn();
+    uint64_t allocs = g_allocs.load(), bytes = g_alloc_bytes.load();
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iters; ++i) fn();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+    printf("%-36s %12.1f ns/op %10.2f allocs/op %12.1f bytes/op\n", name, ns / iters,
+        (double)(g_allocs.load() - allocs) / iters, (double)(g_alloc_bytes.load() - bytes) / iters);
+}
+
+// 空回调 / 空落地
+class NullSink : public LogSink {
+    public:
+        void log(const char *data, size_t) override { doNotOptimize(data); }
+        bool concurrentSafe() const override { return true; }
+};
+
+static void benchFormatter() {
+    LogMsg msg(LogLevel::INFO, 42, "micro_bench.cpp", "micro", std::string(64, 'x'));
+    const char *patterns[][2] = {
+        {"format %d{%H:%M:%S}", "%d{%H:%M:%S}"},
+        {"format %t", "%t"},
+        {"format %c", "%c"},
+        {"format %f", "%f"},
+        {"format %l", "%l"},
+        {"format %p", "%p"},
+        {"format %T", "%T"},
+        {"format %m (64B)", "%m"},
+        {"format %n", "%n"},
+        {"format %r", "%r"},
+        {"format literal", "[abc]"},
+        {"format default pattern", "[%d{%H:%M:%S}][%t][%c][%f:%l][%p]%T%m%n"},
+    };
+    for (auto &p : patterns) {
+        Formatter fmt(p[1]);
+        bench(p[0], 200000, [&]() {
+            std::string s = fmt.format(msg);
+            doNotOptimize(s);
+        });
+    }
+}
+
+static void benchMessage() {
+    std::string file = "micro_bench.cpp", logger = "micro", payload(64, 'x');
+    bench("LogMsg construct", 1000000, [&]() {
+        LogMsg msg(LogLevel::INFO, 42, file, logger, payload);
+        doNotOptimize(msg);
+    });
+}
+
+static void benchBuffer() {
+    std::string line(128, 'x');
+    Buffer buf;
+    bench("Buffer::push 128B record", 2000000, [&]() {
+        if (buf.writeAbleSize() < line.size()) buf.bufferReset();
+        buf.push(line.c_str(), line.size(), LogLevel::INFO);
+    });
+    // 增长只是链接新块，已有数据不搬移；块来自池，第二轮起不再分配
+    Buffer grow;
+    std::string big(64 * 1024, 'x');
+    bench("Buffer::push 16M in 64K records (chunk pool)", 20, [&]() {
+        for (int i = 0; i < 256; ++i) grow.push(big.c_str(), big.size(), LogLevel::INFO);
+        doNotOptimize(grow);
+        grow.bufferReset();
+    });
+}
+
+static void benchLooper() {
+    std::string line(128, 'x');
+    const size_t iters = 2000000;
+    AsynchLooper looper([](Buffer &buf) { doNotOptimize(buf); });
+    bench("AsynchLooper push+swap 128B", iters, [&]() {
+        looper.push(line.c_str(), line.size(), LogLevel::INFO);
+    });
+    looper.flush(std::chrono::seconds(10));
+}
+
+static void benchSinks() {
+    std::string line(128, 'x');
+    line.back() = '\n';
+    const size_t iters = 500000;
+    {
+        NullSink sink;
+        bench("NullSink::write 128B", iters, [&]() { sink.write(line.c_str(), line.size()); });
+    }
+    {
+        FileSink sink("/dev/null");
+        bench("FileSink(/dev/null) 128B", iters, [&]() { sink.write(line.c_str(), line.size()); });
+    }
+    {
+        std::string base = "/dev/shm/micro_bench_roll-";
+        RollBySizeSink sink(base, 64 * 1024 * 1024);
+        bench("RollBySizeSink(tmpfs) 128B", iters, [&]() { sink.write(line.c_str(), line.size()); });
+        system(("rm -f '" + base + "'*").c_str());
+    }
+    {
+        // 临时把标准输出重定向到 /dev/null
+        fflush(stdout);
+        int saved = dup(STDOUT_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        uint64_t allocs = g_allocs.load(), bytes = g_alloc_bytes.load();
+        StdoutSink sink;
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iters; ++i) sink.write(line.c_str(), line.size());
+        sink.flush();
+        auto end = std::chrono::steady_clock::now();
+        dup2(saved, STDOUT_FILENO);
+        close(devnull);
+        close(saved);
+        double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+        if (!g_filter || strstr("StdoutSink(/dev/null) 128B", g_filter))
+            printf("%-36s %12.1f ns/op %10.2f allocs/op %12.1f bytes/op\n", "StdoutSink(/dev/null) 128B", ns / iters,
+                (double)(g_allocs.load() - allocs) / iters, (double)(g_alloc_bytes.load() - bytes) / iters);
+    }
+    {
+        FlightRecorderSink sink("/dev/null", 4 * 1024 * 1024);
+        bench("FlightRecorderSink::record 128B", iters, [&]() { sink.record(LogLevel::DEBUG, line.c_str(), line.size()); });
+        LogMsg msg(LogLevel::DEBUG, __LINE__, __FILE__, "bench", line);
+        bench("FlightRecorderSink::record LogMsg", iters, [&]() { sink.record(msg); });
+    }
+}
+
+static void benchSimd() {
+    // 4KB 的一批日志：每 128 字节一条，不含需要转义的字符
+    std::string batch;
+    while (batch.size() + 128 <= 4096) batch += std::string(127, 'x') + "\n";
+    std::string name = std::string("(") + Simd::isa() + ")";
+    bench(("Simd::countByte 4KB " + name).c_str(), 200000, [&]() {
+        doNotOptimize(Simd::countByte(batch.data(), batch.size(), '\n'));
+    });
+    bench(("Simd::forEachLine 4KB " + name).c_str(), 200000, [&]() {
+        size_t total = 0;
+        Simd::forEachLine(batch.data(), batch.size(), [&](const char *, size_t len) { total += len; });
+        doNotOptimize(total);
+    });
+    bench(("Simd::findEscape 4KB " + name).c_str(), 200000, [&]() {
+        doNotOptimize(Simd::findEscape(batch.data(), batch.size(), true));
+    });
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) g_filter = argv[1];
+    printf("%-36s %15s %20s %22s\n", "benchmark", "time", "allocs", "bytes");
+    benchFormatter();
+    benchMessage();
+    benchBuffer();
+    benchLooper();
+    benchSinks();
+    benchSimd();
+    return 0;
+}
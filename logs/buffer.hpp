@@ -3,67 +3,330 @@
 #include "level.hpp"
 #include <vector>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <assert.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <atomic>
 
-#define DEFAULT_BUFFER_SIZE (1 * 1024 * 1024)//1M大小
-#define THRESHOLD_BUFFER_SIZE (8 * 1024 * 1024)//8M大小
-#define INCREMENT_BUFFER_SIZE (1 * 1024 * 1024)//1M大小
+#define DEFAULT_BUFFER_SIZE (1 * 1024 * 1024)//1M大小，生产缓冲区超过它时生产者阻塞
+#define BUFFER_CHUNK_SIZE (256 * 1024)//每块 256K
+#define DEFAULT_POOLED_CHUNKS 16//空闲链表最多缓存的块数
 
 namespace MySpace{
+    /* 一条日志记录的头：正文地址、等级、写入时间和所属日志器，异步落地时据此过滤、统计、分批，无需重新解析文本。
+       头和正文分开存放，头按 32 字节对齐，一个缓存行正好两条，逐条遍历时不会跨缓存行。
+       正文所在的块不会搬移，data 在记录被处理完之前一直有效 */
+    struct alignas(32) RecordMeta {
+        const char *data;        // 记录正文
+        size_t len;              // 记录长度
+        uint64_t ts_ns;          // 写入时间（CLOCK_REALTIME 纳秒）
+        uint32_t logger_id;      // 日志器编号（Logger::id()），0 表示未知
+        LogLevel::value level;   // 日志等级
+    };
 
+    // 遍历时看到的一条记录：正文直接指向缓冲区，不拷贝
+    struct RecordView {
+        const char *data;
+        size_t len;
+        LogLevel::value level;
+        uint64_t ts_ns;
+        uint32_t logger_id;
+    };
+
+    /* 固定大小块的空闲链表：缓冲区用完的块还回来，下次直接复用，稳定状态下不再分配内存。
+       异步工作器的两个缓冲区共用一个池（生产者取块、消费者还块在不同线程，所以要加锁，每块一次）。
+       空闲一段时间后由工作器调用 trim() 把缓存的块还给系统 */
+    class ChunkPool {
+        public:
+            ChunkPool(size_t chunk_size = BUFFER_CHUNK_SIZE, size_t max_free = DEFAULT_POOLED_CHUNKS)
+                : _chunk_size(chunk_size)
+                , _max_free(max_free)
+            {}
+            ~ChunkPool() {
+                for (char *chunk : _free) unmap(chunk, _chunk_size);
+            }
+            // 取一块至少 size 字节的内存，实际大小写入 got；超过块大小的单独分配
+            char *acquire(size_t size, size_t &got) {
+                if (size <= _chunk_size) {
+                    got = _chunk_size;
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    if (!_free.empty()) {
+                        char *chunk = _free.back();
+                        _free.pop_back();
+                        return chunk;
+                    }
+                } else {
+                    got = (size + 4095) & ~(size_t)4095;
+                }
+                /* 直接 mmap：页面第一次写入时才真正占用内存，也不用像 vector::resize 那样先写一遍 0；
+                   释放时 munmap 一定还给系统（malloc 的大块释放后可能留在堆里） */
+                void *p = ::mmap(nullptr, got, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (p == MAP_FAILED) throw std::bad_alloc();
+                _allocated.fetch_add(got, std::memory_order_relaxed);
+                return static_cast<char *>(p);
+            }
+            // 归还；标准大小的块放回空闲链表，链表已满或是超大块时释放
+            void release(char *chunk, size_t size) {
+                if (size == _chunk_size) {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    if (_free.size() < _max_free) {
+                        _free.push_back(chunk);
+                        return;
+                    }
+                }
+                unmap(chunk, size);
+            }
+            // 释放空闲链表中多于 keep 块的部分，返回释放的字节数
+            size_t trim(size_t keep = 0) {
+                std::vector<char *> victims;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    while (_free.size() > keep) {
+                        victims.push_back(_free.back());
+                        _free.pop_back();
+                    }
+                }
+                for (char *chunk : victims) unmap(chunk, _chunk_size);
+                return victims.size() * _chunk_size;
+            }
+            // 从池中分配出去、尚未释放的字节数（使用中的块 + 空闲链表中的块）
+            size_t allocatedBytes() const { return _allocated.load(std::memory_order_relaxed); }
+            size_t chunkSize() const { return _chunk_size; }
+        private:
+            void unmap(char *chunk, size_t size) {
+                ::munmap(chunk, size);
+                _allocated.fetch_sub(size, std::memory_order_relaxed);
+            }
+        private:
+            size_t _chunk_size;
+            size_t _max_free;
+            std::mutex _mutex;
+            std::vector<char *> _free;
+            std::atomic<size_t> _allocated{0};
+    };
+
+    /* 日志缓冲区：由若干不搬移的块组成，写满一块就从池中再取一块链在后面，已有数据不会被拷贝；
+       一条记录总在同一块内连续存放（比块还大的记录独占一个超大块）。
+       数据整体不连续，按块以 iovec 列表（iovecs()）或 forEachChunk() 交出去 */
     class Buffer{
         public:
-            Buffer() 
-                : _buffer(DEFAULT_BUFFER_SIZE)
-                , _write_idx(0)
-                , _read_idx(0) 
+            // 按写入顺序遍历记录：for (const RecordView &rec : buf.records()) {...}
+            class RecordIterator {
+                public:
+                    RecordIterator(const RecordMeta *meta) : _meta(meta) {}
+                    RecordView operator*() const {
+                        return RecordView{_meta->data, _meta->len, _meta->level, _meta->ts_ns, _meta->logger_id};
+                    }
+                    RecordIterator &operator++() { ++_meta; return *this; }
+                    bool operator!=(const RecordIterator &other) const { return _meta != other._meta; }
+                    bool operator==(const RecordIterator &other) const { return _meta == other._meta; }
+                private:
+                    const RecordMeta *_meta;
+            };
+            class RecordRange {
+                public:
+                    RecordRange(RecordIterator begin, RecordIterator end) : _begin(begin), _end(end) {}
+                    RecordIterator begin() const { return _begin; }
+                    RecordIterator end() const { return _end; }
+                private:
+                    RecordIterator _begin, _end;
+            };
+
+            /* pool 为空时使用自己的池；capacity 是 writeAbleSize() 的上限。
+               构造时不分配任何内存，第一次写入时才取块、才长出记录索引 */
+            Buffer(std::shared_ptr<ChunkPool> pool = nullptr, size_t capacity = DEFAULT_BUFFER_SIZE)
+                : _pool(pool ? pool : std::make_shared<ChunkPool>())
+                , _capacity(capacity)
+                , _size(0)
             {}
-            // 向缓冲区写入数据
-            void push(const char* data, size_t len){
-                // 缓冲区剩余空间不够的情况： 
-                // if (len > writeAbleSize()) return; //情况一满了返回
-                ensureEnoughSize(len); //情况二扩容
-                // 1、将数据拷贝进缓冲区
-                std::copy(data, data + len, &_buffer[_write_idx]);
-                // 2、将当前写入数据向后偏移
-                moveWriter(len);
-            }
-            // 返回可读数据的起始地址
-            const char* begin() { return &_buffer[_read_idx]; }
+            ~Buffer() { releaseChunks(); }
+            Buffer(const Buffer &) = delete;
+            Buffer &operator=(const Buffer &) = delete;
+
+            // 向缓冲区写入数据（保证连续存放），返回写入的位置
+            const char *push(const char* data, size_t len){
+                char *dst = reserve(len);
+                memcpy(dst, data, len);
+                _chunks.back().used += len;
+                _size += len;
+                return dst;
+            }
+            // 写入一条完整的日志记录，并登记它的头；ts_ns 为 0 时取当前时间
+            void push(const char* data, size_t len, LogLevel::value level, uint32_t logger_id = 0, uint64_t ts_ns = 0){
+                const char *dst = push(data, len);
+                _levels[level].push_back(_records.size());
+                _records.push_back(RecordMeta{dst, len, ts_ns ? ts_ns : nowNs(), logger_id, level});
+            }
+            // 把另一个缓冲区中等级 >= min_level 的记录（连同记录头）追加进来；全部满足时每块正文一次拷贝
+            void append(Buffer &other, LogLevel::value min_level = LogLevel::DEBUG) {
+                if (min_level > other.minLevel()) {
+                    for (const RecordMeta &rec : other._records)
+                        if (rec.level >= min_level) push(rec.data, rec.len, rec.level, rec.logger_id, rec.ts_ns);
+                    return;
+                }
+                size_t r = 0;
+                for (const Chunk &chunk : other._chunks) {
+                    if (chunk.used == 0) continue;
+                    const char *dst = push(chunk.data, chunk.used);
+                    // 记录和块都是按写入顺序排列的，落在这一块中的记录连续出现
+                    for (; r < other._records.size(); ++r) {
+                        const RecordMeta &rec = other._records[r];
+                        if (rec.data < chunk.data || rec.data >= chunk.data + chunk.used) break;
+                        _levels[rec.level].push_back(_records.size());
+                        _records.push_back(rec);
+                        _records.back().data = dst + (rec.data - chunk.data);
+                    }
+                }
+            }
+            // 记录数量
+            size_t recordCount() { return _records.size(); }
+            // 第 i 条记录
+            const RecordMeta &record(size_t i) { return _records[i]; }
+            RecordRange records() {
+                return RecordRange(RecordIterator(_records.data()), RecordIterator(_records.data() + _records.size()));
+            }
+            // 按等级分桶的记录下标（升序），只关心高等级的落地方向不必扫描全部记录
+            const std::vector<size_t> &recordsOf(LogLevel::value level) { return _levels[level]; }
+            // 缓冲区内的最低日志等级，没有记录时返回 OFF
+            LogLevel::value minLevel() {
+                for (int l = LogLevel::DEBUG; l < LogLevel::OFF; ++l)
+                    if (!_levels[l].empty()) return (LogLevel::value)l;
+                return LogLevel::OFF;
+            }
+            // 等级 >= min_level 的记录的总字节数（即 forEachRun(min_level, ...) 交出的字节数）
+            size_t bytesOf(LogLevel::value min_level) {
+                if (min_level <= minLevel()) return _size;
+                size_t bytes = 0;
+                for (int l = min_level; l < LogLevel::OFF; ++l)
+                    for (size_t i : _levels[l]) bytes += _records[i].len;
+                return bytes;
+            }
+            /* 按写入顺序对等级 >= min_level 的记录调用 fn(data, len)，首尾相接的记录合并成一次调用：
+               全部满足时就是逐块调用；否则按等级桶归并出记录下标（只关心高等级时不必扫描全部记录） */
+            template<class F>
+            void forEachRun(LogLevel::value min_level, F &&fn) {
+                if (min_level <= minLevel()) {
+                    forEachChunk(fn);
+                    return;
+                }
+                const std::vector<size_t> *buckets[LogLevel::OFF];
+                size_t heads[LogLevel::OFF];
+                int n = 0;
+                for (int l = min_level; l < LogLevel::OFF; ++l) {
+                    if (_levels[l].empty()) continue;
+                    buckets[n] = &_levels[l];
+                    heads[n] = 0;
+                    ++n;
+                }
+                const char *run_begin = nullptr, *run_end = nullptr;   // 当前连续区间 [run_begin, run_end)
+                while (n > 0) {
+                    // 在各个桶的队头中取下标最小的记录
+                    int pick = 0;
+                    for (int i = 1; i < n; ++i)
+                        if ((*buckets[i])[heads[i]] < (*buckets[pick])[heads[pick]]) pick = i;
+                    const RecordMeta &rec = _records[(*buckets[pick])[heads[pick]]];
+                    if (++heads[pick] == buckets[pick]->size()) {
+                        buckets[pick] = buckets[n - 1];
+                        heads[pick] = heads[n - 1];
+                        --n;
+                    }
+                    // 同一块内首尾相接的记录合并（跨块的记录地址不连续，自然分开）
+                    if (run_begin && rec.data == run_end) {
+                        run_end += rec.len;
+                        continue;
+                    }
+                    if (run_begin) fn(run_begin, (size_t)(run_end - run_begin));
+                    run_begin = rec.data;
+                    run_end = rec.data + rec.len;
+                }
+                if (run_begin) fn(run_begin, (size_t)(run_end - run_begin));
+            }
+            // 按顺序对每个非空块调用 fn(data, len)；不分配内存，可以在信号处理函数中使用
+            template<class F>
+            void forEachChunk(F &&fn) {
+                for (const Chunk &chunk : _chunks)
+                    if (chunk.used > 0) fn(chunk.data, chunk.used);
+            }
+            // 各块的 iovec 列表，直接交给 writev
+            const std::vector<struct iovec> &iovecs() {
+                _iov.clear();
+                for (const Chunk &chunk : _chunks)
+                    if (chunk.used > 0) _iov.push_back(iovec{chunk.data, chunk.used});
+                return _iov;
+            }
             // 返回可读数据的长度
-            size_t readAbleSize() { return _write_idx-_read_idx; }
-            // 返回可写空间的长度
-            size_t writeAbleSize() { return _buffer.size()-_write_idx; }
-            // 对读写指针进行向后偏移操作
-            void moveWriter(size_t len) { assert(len+_write_idx <= writeAbleSize()); _write_idx += len; }
-            // 对读写指针进行向后偏移操作
-            void moveReader(size_t len) { assert(len <= readAbleSize()); _read_idx += len; }
-            // 重制读写位置，初始化缓冲区
-            void bufferReset() { _read_idx = 0; _write_idx = 0; }
-            // 对buffer实现交换的操作
+            size_t readAbleSize() { return _size; }
+            // 返回可写空间的长度（按容量上限计算，块本身可以继续链接）
+            size_t writeAbleSize() { return _capacity > _size ? _capacity - _size : 0; }
+            // 重制读写位置，初始化缓冲区，块还给池
+            void bufferReset() {
+                releaseChunks();
+                _size = 0;
+                _records.clear();
+                for (auto &bucket : _levels) bucket.clear();
+            }
+            // 对buffer实现交换的操作（只交换块链表和记录，不拷贝数据）
             void bufferSwap(Buffer &buffer){
-                _buffer.swap(buffer._buffer);
-                std::swap(_read_idx, buffer._read_idx);
-                std::swap(_write_idx, buffer._write_idx);
+                _chunks.swap(buffer._chunks);
+                std::swap(_size, buffer._size);
+                std::swap(_capacity, buffer._capacity);
+                _records.swap(buffer._records);
+                for (int l = 0; l < LogLevel::OFF; ++l) _levels[l].swap(buffer._levels[l]);
             }
             // 判断缓冲区是否为空
-            bool bufferEmpty() { return _read_idx == _write_idx; }
-            // 对空间进行扩容操作
-            void ensureEnoughSize(size_t len){
-                if (len <= writeAbleSize()) return;
-                size_t new_size = 0;
-                while (writeAbleSize() < len) {
-                    if (_buffer.size() < THRESHOLD_BUFFER_SIZE) {
-                        new_size = _buffer.size() * 2; // 小于阈值翻倍增长
-                    } else {
-                        new_size = _buffer.size() + INCREMENT_BUFFER_SIZE; // 大于阈值线性增长
-                    }
-                    _buffer.resize(new_size);
+            bool bufferEmpty() { return _size == 0; }
+            // 空缓冲区释放突发时长大的记录索引（块已经在 bufferReset() 时还给池）
+            void shrink() {
+                if (!bufferEmpty()) return;
+                std::vector<RecordMeta>().swap(_records);
+                for (auto &bucket : _levels) std::vector<size_t>().swap(bucket);
+                std::vector<struct iovec>().swap(_iov);
+            }
+            // 记录索引占用的字节数（块的内存由 ChunkPool::allocatedBytes() 统计）
+            size_t indexBytes() {
+                size_t bytes = _records.capacity() * sizeof(RecordMeta) + _iov.capacity() * sizeof(struct iovec);
+                for (auto &bucket : _levels) bytes += bucket.capacity() * sizeof(size_t);
+                return bytes;
+            }
+            // 记录头使用的时间
+            static uint64_t nowNs() {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+            }
+        private:
+            struct Chunk {
+                char *data;
+                size_t size;    // 块大小
+                size_t used;    // 已写入的字节数
+            };
+            // 返回能连续写入 len 字节的位置，当前块放不下时链接新块
+            char *reserve(size_t len) {
+                if (_chunks.empty() || _chunks.back().size - _chunks.back().used < len) {
+                    Chunk chunk;
+                    chunk.data = _pool->acquire(len, chunk.size);
+                    chunk.used = 0;
+                    _chunks.push_back(chunk);
                 }
+                return _chunks.back().data + _chunks.back().used;
+            }
+            void releaseChunks() {
+                for (const Chunk &chunk : _chunks) _pool->release(chunk.data, chunk.size);
+                _chunks.clear();
             }
         private:
-            std::vector<char> _buffer;  // 存放字符串数据缓冲区
-            size_t _read_idx;           // 当前可读数据的指针
-            size_t _write_idx;          // 当前可写数据的指针
+            std::shared_ptr<ChunkPool> _pool;  // 块的来源
+            std::vector<Chunk> _chunks;        // 块链表（按写入顺序）
+            size_t _capacity;                  // 容量上限
+            size_t _size;                      // 已写入的总字节数
+            std::vector<struct iovec> _iov;    // iovecs() 的结果
+            std::vector<RecordMeta> _records;              // 记录索引（按写入顺序）
+            std::vector<size_t> _levels[LogLevel::OFF];    // 按等级分桶的记录下标
         };
-}
\ No newline at end of file
+}
@@ -0,0 +1,211 @@
+//config.hpp
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include "logger.hpp"
+#include "router.hpp"
+
+/*
+    日志配置文件与热加载。配置为 INI 格式，每节的名字是日志器名称模式（支持 * 和 ?），按出现顺序应用，后面的覆盖前面的：
+
+        [*]
+        level = INFO
+
+        [db.*]
+        level = DEBUG
+        pattern = [%d{%H:%M:%S}][%t][%c][%p] %m%F%n
+        sinks = stdout, file:./logs/db.log
+
+    level   日志等级
+    format  pattern（默认）/ json / logfmt
+    pattern 格式化字符串（format 为 json/logfmt 时是时间格式）
+    sinks   逗号分隔：stdout、file:路径，或 SinkRegistry 中已登记的名字
+
+    只对 LoggerManager 中登记过的日志器生效。ConfigWatcher 用 inotify 监视文件所在目录，
+    文件被改写或替换（编辑器常用先写临时文件再 rename 的方式）后重新加载。
+*/
+namespace MySpace{
+    class LogConfig {
+        public:
+            struct Section {
+                std::string pattern;                        // 日志器名称模式
+                std::map<std::string, std::string> values;  // 键值
+            };
+            // 解析 INI 文本，# 或 ; 开头的行为注释
+            static std::vector<Section> parse(const std::string &text) {
+                std::vector<Section> sections;
+                std::istringstream in(text);
+                std::string line;
+                while (std::getline(in, line)) {
+                    line = trim(line);
+                    if (line.empty() || line[0] == '#' || line[0] == ';') continue;
+                    if (line[0] == '[' && line.back() == ']') {
+                        sections.push_back(Section{trim(line.substr(1, line.size() - 2)), {}});
+                        continue;
+                    }
+                    size_t eq = line.find('=');
+                    if (eq == std::string::npos || sections.empty()) {
+                        std::cerr << "无法解析的配置行: " << line << std::endl;
+                        continue;
+                    }
+                    sections.back().values[trim(line.substr(0, eq))] = trim(line.substr(eq + 1));
+                }
+                return sections;
+            }
+            // 读取配置文件并应用到所有登记过的日志器
+            static bool load(const std::string &path) {
+                std::ifstream ifs(path);
+                if (!ifs.is_open()) {
+                    std::cerr << "打开配置文件失败: " << path << std::endl;
+                    return false;
+                }
+                std::stringstream text;
+                text << ifs.rdbuf();
+                apply(parse(text.str()));
+                return true;
+            }
+            static void apply(const std::vector<Section> &sections) {
+                for (auto &logger : LoggerManager::getInstance().loggers()) {
+                    for (auto &section : sections) {
+                        if (RouteTable::match(section.pattern, logger->name()))
+                            applySection(*logger, section);
+                    }
+                }
+            }
+        private:
+            static void applySection(Logger &logger, const Section &section) {
+                auto it = section.values.find("level");
+                if (it != section.values.end()) {
+                    LogLevel::value level;
+                    if (LogLevel::fromString(it->second, level)) logger.setLevel(level);
+                    else std::cerr << "未知的日志等级: " << it->second << std::endl;
+                }
+                auto format = section.values.find("format");
+                auto pattern = section.values.find("pattern");
+                if (format != section.values.end() || pattern != section.values.end()) {
+                    std::shared_ptr<Formatter> formatter = makeFormatter(
+                        format == section.values.end() ? "pattern" : format->second,
+                        pattern == section.values.end() ? "" : pattern->second);
+                    // 和当前的相同时不替换，避免反复加载时堆积被替换下来的对象
+                    Formatter &cur = logger.formatter();
+                    if (formatter && (cur.mode() != formatter->mode() || cur.pattern() != formatter->pattern()))
+                        logger.setFormatter(formatter);
+                }
+                it = section.values.find("sinks");
+                if (it != section.values.end()) {
+                    SinkList sinks;
+                    std::istringstream in(it->second);
+                    std::string spec;
+                    while (std::getline(in, spec, ',')) {
+                        spec = trim(spec);
+                        if (spec.empty()) continue;
+                        auto sink = resolveSink(spec);
+                        if (sink) sinks.push_back(sink);
+                        else std::cerr << "未知的落地方向: " << spec << std::endl;
+                    }
+                    if (!sinks.empty() && sinks != logger.sinks())
+                        logger.setSinks(sinks);
+                }
+            }
+            static std::shared_ptr<Formatter> makeFormatter(const std::string &format, const std::string &pattern) {
+                if (format == "json")
+                    return pattern.empty() ? std::make_shared<Formatter>(FORMAT_JSON) : std::make_shared<Formatter>(FORMAT_JSON, pattern);
+                if (format == "logfmt")
+                    return pattern.empty() ? std::make_shared<Formatter>(FORMAT_LOGFMT) : std::make_shared<Formatter>(FORMAT_LOGFMT, pattern);
+                if (format != "pattern") {
+                    std::cerr << "未知的输出格式: " << format << std::endl;
+                    return nullptr;
+                }
+                return pattern.empty() ? std::make_shared<Formatter>() : std::make_shared<Formatter>(pattern);
+            }
+            static std::shared_ptr<LogSink> resolveSink(const std::string &spec) {
+                SinkRegistry &registry = SinkRegistry::getInstance();
+                if (spec == "stdout") return registry.stdout_();
+                if (spec.compare(0, 5, "file:") == 0) return registry.file(spec.substr(5));
+                return registry.get(spec);
+            }
+            static std::string trim(const std::string &str) {
+                size_t begin = str.find_first_not_of(" \t\r\n");
+                if (begin == std::string::npos) return "";
+                size_t end = str.find_last_not_of(" \t\r\n");
+                return str.substr(begin, end - begin + 1);
+            }
+    };
+
+    /* 监视配置文件，变化后在后台线程中重新加载；日志线程不受影响 */
+    class ConfigWatcher {
+        public:
+            ConfigWatcher(const std::string &path, bool load_now = true)
+                : _path(path)
+                , _reloads(0)
+            {
+                if (load_now) LogConfig::load(_path);
+                _inotify = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+                if (_inotify < 0 || pipe2(_stop_pipe, O_CLOEXEC) != 0) {
+                    std::cerr << "创建配置文件监视失败: " << _path << std::endl;
+                    return;
+                }
+                // 监视所在目录而不是文件本身，文件被 rename 替换后仍然有效
+                std::string dir = util::getDirectory(_path);
+                size_t pos = _path.find_last_of("/\\");
+                _filename = pos == std::string::npos ? _path : _path.substr(pos + 1);
+                if (inotify_add_watch(_inotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+                    std::cerr << "监视配置目录失败: " << dir << std::endl;
+                    return;
+                }
+                _thread = std::thread(&ConfigWatcher::threadEntry, this);
+            }
+            ~ConfigWatcher() {
+                if (_thread.joinable()) {
+                    char c = 0;
+                    ssize_t ret = ::write(_stop_pipe[1], &c, 1);
+                    (void)ret;
+                    _thread.join();
+                }
+                if (_inotify >= 0) ::close(_inotify);
+                if (_stop_pipe[0] >= 0) ::close(_stop_pipe[0]);
+                if (_stop_pipe[1] >= 0) ::close(_stop_pipe[1]);
+            }
+            // 已经重新加载的次数
+            size_t reloads() const { return _reloads.load(); }
+        private:
+            void threadEntry() {
+                alignas(struct inotify_event) char buf[4096];
+                struct pollfd fds[2] = {{_inotify, POLLIN, 0}, {_stop_pipe[0], POLLIN, 0}};
+                while (true) {
+                    if (::poll(fds, 2, -1) < 0) {
+                        if (errno == EINTR) continue;
+                        break;
+                    }
+                    if (fds[1].revents) break;
+                    bool changed = false;
+                    ssize_t n;
+                    while ((n = ::read(_inotify, buf, sizeof(buf))) > 0) {
+                        for (char *p = buf; p < buf + n; ) {
+                            struct inotify_event *ev = reinterpret_cast<struct inotify_event *>(p);
+                            if (ev->len > 0 && _filename == ev->name) changed = true;
+                            p += sizeof(struct inotify_event) + ev->len;
+                        }
+                    }
+                    if (changed && LogConfig::load(_path)) _reloads++;
+                }
+            }
+        private:
+            std::string _path;
+            std::string _filename;
+            int _inotify = -1;
+            int _stop_pipe[2] = {-1, -1};
+            std::atomic<size_t> _reloads;
+            std::thread _thread;
+    };
+}
@@ -0,0 +1,101 @@
+//coro.hpp
+#pragma once
+/*
+    C++20 协程接口（需要 -std=c++20，CMake 选项 LOG_ENABLE_COROUTINES 打开时构建 coro_bench）：
+    异步日志器的生产缓冲区满时，AsynchLooper::push 在 _produce_cond 上阻塞整个线程，
+    同一个执行器线程上的其他协程也跟着停住。这里的 awaitable 在缓冲区满时只挂起当前协程，
+    工作线程交换缓冲区后按挂起顺序把记录写进新的生产缓冲区，再把协程投递回它自己的执行器恢复。
+
+    执行器只需要提供线程安全的 void post(std::coroutine_handle<>)：唤醒发生在日志器的工作线程中，
+    协程不能在那里直接恢复（会占住日志线程），只能交回执行器。
+
+        co_await MySpace::logAsync(*logger, exec, MySpace::LogLevel::INFO, __FILE__, __LINE__, "msg");
+        co_await LOG_CO(logger, exec, INFO, "msg");      // 同上，自动填充文件名和行号
+        co_await MySpace::flushAsync(*logger, exec);     // 挂起直到此前的日志全部落地并刷新
+
+    等级达到 flushLevel() 的日志在写入后还会等待一次 flush，与阻塞接口的行为一致。
+    同步日志器没有缓冲区，这些 awaitable 直接写出，不会挂起。
+    不编译为 C++20 时本文件为空，原有的 C++17 接口不受影响。
+*/
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine>
+#include <string>
+#include "logger.hpp"
+
+namespace MySpace{
+    // co_await 一条日志：缓冲区放得下时不挂起
+    template<class Executor>
+    class LogAwaiter {
+        public:
+            LogAwaiter(Logger &logger, Executor &exec, LogLevel::value level, const std::string &file, size_t line
+                , const std::string &message, std::initializer_list<LogField> fields)
+                : _logger(logger), _exec(exec), _level(level)
+            {
+                // 过滤和格式化在调用线程中完成，挂起期间记录保存在协程帧里
+                _ready = !logger.render(level, file, line, message, fields, _data);
+                _flush = level >= logger.flushLevel();
+            }
+            LogAwaiter(const LogAwaiter &) = delete;
+            LogAwaiter &operator=(const LogAwaiter &) = delete;
+
+            // 被过滤掉的日志不挂起
+            bool await_ready() const noexcept { return _ready; }
+            bool await_suspend(std::coroutine_handle<> h) {
+                _handle = h;
+                if (!_logger.tryLog(_level, _data.data(), _data.size(), [this]() { pushed(); }))
+                    return true;
+                if (!_flush) return false;
+                Executor *exec = &_exec;
+                return !_logger.tryFlush([exec, h]() { exec->post(h); });
+            }
+            void await_resume() const noexcept {}
+        private:
+            // 在工作线程中调用：记录已经写入缓冲区
+            void pushed() {
+                // 投递之后协程随时可能恢复并销毁 this，先把要用的取出来
+                Executor *exec = &_exec;
+                std::coroutine_handle<> h = _handle;
+                if (!_flush || _logger.tryFlush([exec, h]() { exec->post(h); }))
+                    exec->post(h);
+            }
+        private:
+            Logger &_logger;
+            Executor &_exec;
+            LogLevel::value _level;
+            std::string _data;                  // render 的结果，挂起期间由工作线程读取
+            std::coroutine_handle<> _handle;
+            bool _ready;                        // 被过滤，不需要写入
+            bool _flush;                        // 写入后还要等待 flush
+    };
+
+    // co_await 一次 flush
+    template<class Executor>
+    class FlushAwaiter {
+        public:
+            FlushAwaiter(Logger &logger, Executor &exec) : _logger(logger), _exec(exec) {}
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> h) {
+                Executor *exec = &_exec;
+                return !_logger.tryFlush([exec, h]() { exec->post(h); });
+            }
+            void await_resume() const noexcept {}
+        private:
+            Logger &_logger;
+            Executor &_exec;
+    };
+
+    template<class Executor>
+    inline LogAwaiter<Executor> logAsync(Logger &logger, Executor &exec, LogLevel::value level
+        , const std::string &file, size_t line, const std::string &message, std::initializer_list<LogField> fields = {}) {
+        return LogAwaiter<Executor>(logger, exec, level, file, line, message, fields);
+    }
+
+    template<class Executor>
+    inline FlushAwaiter<Executor> flushAsync(Logger &logger, Executor &exec) {
+        return FlushAwaiter<Executor>(logger, exec);
+    }
+
+    #define LOG_CO(logger, exec, level, fmt, ...) \
+        MySpace::logAsync(*(logger), exec, MySpace::LogLevel::level, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+}
+#endif
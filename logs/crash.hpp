@@ -0,0 +1,113 @@
+//crash.hpp
+#pragma once
+#include <atomic>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+
+#define MAX_CRASH_DRAINS 64 // 最多登记的崩溃回调数量
+
+namespace MySpace{
+    /*
+        崩溃信号处理：收到 SIGSEGV/SIGABRT/SIGBUS/SIGFPE/SIGILL 时，依次调用登记的回调把内存中尚未落地的日志写出，
+        再恢复原来的信号处理方式并重新触发信号。
+        信号处理函数中只能做异步信号安全的操作：不加锁、不分配内存、只用 write(2) 输出。
+    */
+    class CrashHandler {
+        public:
+            using DrainFunc = void (*)(void *arg);
+
+            // 安装信号处理函数（重复调用只安装一次）
+            static bool install() {
+                bool expected = false;
+                if (!_installed.compare_exchange_strong(expected, true)) return true;
+                static const int sigs[] = { SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL };
+                struct sigaction sa;
+                sa.sa_sigaction = &CrashHandler::handler;
+                sigemptyset(&sa.sa_mask);
+                sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+                for (int sig : sigs) {
+                    if (sigaction(sig, &sa, &_old_actions[sig]) != 0) return false;
+                }
+                return true;
+            }
+            // 登记一个崩溃回调，返回槽位编号，槽位用完返回 -1
+            static int registerDrain(DrainFunc fn, void *arg) {
+                for (int i = 0; i < MAX_CRASH_DRAINS; ++i) {
+                    bool expected = false;
+                    if (_slots[i].used.compare_exchange_strong(expected, true)) {
+                        _slots[i].arg.store(arg, std::memory_order_relaxed);
+                        _slots[i].fn.store(fn, std::memory_order_release);
+                        return i;
+                    }
+                }
+                return -1;
+            }
+            // 注销崩溃回调
+            static void unregisterDrain(int slot) {
+                if (slot < 0 || slot >= MAX_CRASH_DRAINS) return;
+                _slots[slot].fn.store(nullptr, std::memory_order_release);
+                _slots[slot].arg.store(nullptr, std::memory_order_relaxed);
+                _slots[slot].used.store(false, std::memory_order_release);
+            }
+            // 异步信号安全的写：处理 EINTR 和部分写
+            static bool writeAll(int fd, const char *data, size_t len) {
+                while (len > 0) {
+                    ssize_t n = ::write(fd, data, len);
+                    if (n < 0) {
+                        if (errno == EINTR) continue;
+                        return false;
+                    }
+                    data += n;
+                    len -= (size_t)n;
+                }
+                return true;
+            }
+            // 同上，一次 writev 写出多段（会修改 iov），每次最多 IOV_MAX 段
+            static bool writevAll(int fd, struct iovec *iov, int count) {
+                while (count > 0) {
+                    ssize_t n = ::writev(fd, iov, count < IOV_MAX ? count : IOV_MAX);
+                    if (n < 0) {
+                        if (errno == EINTR) continue;
+                        return false;
+                    }
+                    while (count > 0 && (size_t)n >= iov->iov_len) {
+                        n -= iov->iov_len;
+                        ++iov;
+                        --count;
+                    }
+                    if (count > 0) {
+                        iov->iov_base = static_cast<char *>(iov->iov_base) + n;
+                        iov->iov_len -= n;
+                    }
+                }
+                return true;
+            }
+        private:
+            static void handler(int sig, siginfo_t *, void *) {
+                // 防止处理过程中再次崩溃导致递归
+                if (!_handling.exchange(true)) {
+                    for (int i = 0; i < MAX_CRASH_DRAINS; ++i) {
+                        DrainFunc fn = _slots[i].fn.load(std::memory_order_acquire);
+                        if (fn) fn(_slots[i].arg.load(std::memory_order_relaxed));
+                    }
+                }
+                // 恢复原来的处理方式后重新触发，保留 core dump 等默认行为
+                sigaction(sig, &_old_actions[sig], nullptr);
+                raise(sig);
+            }
+        private:
+            // 静态存储期对象会被零初始化，槽位初始即为空
+            struct Slot {
+                std::atomic<bool> used;
+                std::atomic<DrainFunc> fn;
+                std::atomic<void *> arg;
+            };
+            inline static Slot _slots[MAX_CRASH_DRAINS];
+            inline static struct sigaction _old_actions[NSIG];
+            inline static std::atomic<bool> _installed{false};
+            inline static std::atomic<bool> _handling{false};
+    };
+}
@@ -0,0 +1,63 @@
+//escape.hpp
+#pragma once
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include "simd.hpp"
+
+/*
+    JSON / logfmt 字符串转义。
+    绝大多数日志内容不需要转义，所以先找出第一个需要转义的字符（Simd::findEscape），之前的部分整段拷贝。
+*/
+namespace MySpace{
+    class Escape {
+        public:
+            // 追加 JSON 字符串（含两侧引号）
+            static void appendJson(std::string &out, const char *s, size_t len) {
+                out.push_back('"');
+                appendEscaped(out, s, len);
+                out.push_back('"');
+            }
+            // 追加 logfmt 值：不含空格、=、引号和控制字符的原样输出，否则加引号转义
+            static void appendLogfmt(std::string &out, const char *s, size_t len) {
+                if (len > 0 && findSpecial(s, len, true) == len) {
+                    out.append(s, len);
+                    return;
+                }
+                out.push_back('"');
+                appendEscaped(out, s, len);
+                out.push_back('"');
+            }
+            /* 返回第一个需要转义的字符位置，没有则返回 len。
+               需要转义的字符：控制字符（< 0x20）、双引号、反斜杠；logfmt 为 true 时还包括空格和 = */
+            static size_t findSpecial(const char *s, size_t len, bool logfmt) {
+                return Simd::findEscape(s, len, logfmt);
+            }
+        private:
+            static void appendEscaped(std::string &out, const char *s, size_t len) {
+                static const char hex[] = "0123456789abcdef";
+                size_t pos = 0;
+                while (pos < len) {
+                    size_t hit = pos + findSpecial(s + pos, len - pos, false);
+                    out.append(s + pos, hit - pos);
+                    if (hit == len) break;
+                    unsigned char c = (unsigned char)s[hit];
+                    switch (c) {
+                        case '"':  out.append("\\\""); break;
+                        case '\\': out.append("\\\\"); break;
+                        case '\n': out.append("\\n"); break;
+                        case '\r': out.append("\\r"); break;
+                        case '\t': out.append("\\t"); break;
+                        default:
+                            if (c < 0x20) {
+                                char buf[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                                out.append(buf, 6);
+                            } else {
+                                out.push_back((char)c);
+                            }
+                    }
+                    pos = hit + 1;
+                }
+            }
+    };
+}
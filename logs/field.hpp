@@ -0,0 +1,42 @@
+//field.hpp
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace MySpace{
+    /* 结构化日志的键值字段：按类型保存原始值，只在格式化（异步日志器中即工作线程）时才转成文本
+       用法：logger->info(__FILE__, __LINE__, "login", {{"user", uid}, {"ok", true}, {"ip", ip}}); */
+    class LogField {
+        public:
+            enum Type : uint8_t {
+                INT,
+                UINT,
+                DOUBLE,
+                BOOL,
+                STRING
+            };
+            template<class T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+            LogField(const std::string &key, T value) : _key(key), _type(INT) { _value.i = value; }
+            template<class T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value
+                && !std::is_same<T, bool>::value, int>::type = 0>
+            LogField(const std::string &key, T value) : _key(key), _type(UINT) { _value.u = value; }
+            template<class T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+            LogField(const std::string &key, T value) : _key(key), _type(DOUBLE) { _value.d = value; }
+            LogField(const std::string &key, bool value) : _key(key), _type(BOOL) { _value.b = value; }
+            LogField(const std::string &key, const char *value) : _key(key), _type(STRING), _str(value) { _value.u = 0; }
+            LogField(const std::string &key, const std::string &value) : _key(key), _type(STRING), _str(value) { _value.u = 0; }
+
+            std::string _key;
+            Type _type;
+            union {
+                int64_t i;
+                uint64_t u;
+                double d;
+                bool b;
+            } _value;
+            std::string _str;     // STRING 类型的值
+    };
+    using LogFields = std::vector<LogField>;
+}
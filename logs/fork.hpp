@@ -0,0 +1,74 @@
+//fork.hpp
+#pragma once
+#include <mutex>
+#include <vector>
+#include <pthread.h>
+
+namespace MySpace{
+    /*
+        fork 处理：进程 fork 时子进程只有调用 fork 的那个线程，其余线程（异步工作线程、定时写出线程）都不存在，
+        它们当时持有的锁在子进程中也永远不会释放。有后台线程的对象在这里登记三个回调（pthread_atfork）：
+          prepare：父进程 fork 前调用，让后台线程停在安全点（没有正在处理的批次、不持有落地方向的锁），并持有自己的锁
+          parent ：父进程 fork 后调用，释放锁，后台线程继续
+          child  ：子进程中调用，丢弃从父进程继承的待写数据（由父进程写出，避免重复），重新初始化同步原语并启动新的后台线程
+        prepare 按登记的逆序调用：落地方向先于使用它的日志器创建，日志器的工作线程先停下，
+        不会卡在往已经停下的落地方向写数据上；parent/child 按登记顺序调用。
+    */
+    class ForkHandler {
+        public:
+            using ForkFunc = void (*)(void *arg);
+
+            // 登记一组 fork 回调，返回编号
+            static int registerHandler(ForkFunc prepare, ForkFunc parent, ForkFunc child, void *arg) {
+                State &s = state();
+                std::unique_lock<std::mutex> lock(s.mutex);
+                s.entries.push_back(Entry{++s.next_id, prepare, parent, child, arg});
+                return s.next_id;
+            }
+            // 注销（对象析构前调用；正在 fork 时会等 fork 完成）
+            static void unregisterHandler(int id) {
+                State &s = state();
+                std::unique_lock<std::mutex> lock(s.mutex);
+                for (auto it = s.entries.begin(); it != s.entries.end(); ++it) {
+                    if (it->id == id) {
+                        s.entries.erase(it);
+                        return;
+                    }
+                }
+            }
+        private:
+            struct Entry {
+                int id;
+                ForkFunc prepare;
+                ForkFunc parent;
+                ForkFunc child;
+                void *arg;
+            };
+            struct State {
+                State() { pthread_atfork(&ForkHandler::prepareAll, &ForkHandler::parentAll, &ForkHandler::childAll); }
+                std::mutex mutex;           // fork 期间一直持有，期间不能登记/注销
+                std::vector<Entry> entries; // 按登记顺序
+                int next_id = 0;
+            };
+            // 故意不析构：静态析构阶段仍可能有对象注销
+            static State &state() {
+                static State *s = new State();
+                return *s;
+            }
+            static void prepareAll() {
+                State &s = state();
+                s.mutex.lock();
+                for (auto it = s.entries.rbegin(); it != s.entries.rend(); ++it) it->prepare(it->arg);
+            }
+            static void parentAll() {
+                State &s = state();
+                for (auto &e : s.entries) e.parent(e.arg);
+                s.mutex.unlock();
+            }
+            static void childAll() {
+                State &s = state();
+                for (auto &e : s.entries) e.child(e.arg);
+                s.mutex.unlock();
+            }
+    };
+}
@@ -3,10 +3,14 @@
 #include "level.hpp"
 #include "util.hpp"
 #include "message.hpp"
+#include "escape.hpp"
 #include <vector>
 #include <iostream>
 #include <unordered_map>
 #include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <charconv>
 #include <assert.h>
 
 namespace MySpace{
@@ -63,7 +67,30 @@ namespace MySpace{
     class tidFormatItem : public FormatItem{
         public:
         virtual void format(std::ostream& out, LogMsg& msg) override{
-            out<<msg._tid;
+            // 本线程的日志直接用缓存好的文本；异步结构化格式在工作线程中格式化时才需要现转
+            const ThreadInfo &self = ThreadInfo::current();
+            if (msg._tid == self.tid()) {
+                out.write(self.tidText(), self.tidTextLen());
+                return;
+            }
+            char buf[12];
+            auto r = std::to_chars(buf, buf + sizeof(buf), msg._tid);
+            out.write(buf, r.ptr - buf);
+        }
+    };
+    //线程名，未设置名字的线程输出线程ID
+    class threadNameFormatItem : public FormatItem{
+        public:
+        virtual void format(std::ostream& out, LogMsg& msg) override{
+            if (msg._thread_name.empty()) out<<msg._tid;
+            else out<<msg._thread_name;
+        }
+    };
+    //采样率，下游按该值放大计数
+    class sampleRateFormatItem : public FormatItem{
+        public:
+        virtual void format(std::ostream& out, LogMsg& msg) override{
+            out<<msg._sample_rate;
         }
     };
     //日志器名称
@@ -73,6 +100,54 @@ namespace MySpace{
             out<<msg._logger;
         }
     };
+    //结构化字段的值转成文本
+    class FieldText {
+        public:
+            // json 为 true 时按 JSON 规则输出（字符串加引号，非有限浮点数输出 null），否则按 logfmt
+            static void append(std::string &out, const LogField &field, bool json) {
+                char buf[32];
+                switch (field._type) {
+                    case LogField::INT: {
+                        auto r = std::to_chars(buf, buf + sizeof(buf), field._value.i);
+                        out.append(buf, r.ptr - buf);
+                        break;
+                    }
+                    case LogField::UINT: {
+                        auto r = std::to_chars(buf, buf + sizeof(buf), field._value.u);
+                        out.append(buf, r.ptr - buf);
+                        break;
+                    }
+                    case LogField::DOUBLE: {
+                        if (json && !std::isfinite(field._value.d)) { out.append("null"); break; }
+                        int n = snprintf(buf, sizeof(buf), "%.17g", field._value.d);
+                        out.append(buf, n);
+                        break;
+                    }
+                    case LogField::BOOL:
+                        out.append(field._value.b ? "true" : "false");
+                        break;
+                    case LogField::STRING:
+                        if (json) Escape::appendJson(out, field._str.data(), field._str.size());
+                        else Escape::appendLogfmt(out, field._str.data(), field._str.size());
+                        break;
+                }
+            }
+    };
+    //结构化字段，按 logfmt 输出为 " key=value key=value"
+    class fieldsFormatItem : public FormatItem{
+        public:
+        virtual void format(std::ostream& out, LogMsg& msg) override{
+            if (msg._fields.empty()) return;
+            std::string text;
+            for (auto &field : msg._fields) {
+                text.push_back(' ');
+                Escape::appendLogfmt(text, field._key.data(), field._key.size());
+                text.push_back('=');
+                FieldText::append(text, field, false);
+            }
+            out<<text;
+        }
+    };
     //制表符缩进
     class TabFormatItem  : public FormatItem{
         public:
@@ -101,7 +176,8 @@ namespace MySpace{
     };
     /* 
         %d  表示日期，    子格式 {%H:%M:%S}， [%d{%H:%M:%S}] → [12:30:45]
-        %t  表示线程ID ， [%t] → [1234567890]
+        %t  表示线程ID（内核线程号）， [%t] → [12345]
+        %N  表示线程名（ThreadInfo::setName 设置，未设置时输出线程ID）， [%N] → [worker-1]
         %c  表示日志器名称， [%c] → [sync_logger]
         %f  表示源码文件名， [%f] → [main.cpp]
         %l  表示源码行号， [%l] → [123]
@@ -109,26 +185,66 @@ namespace MySpace{
         %T  表示制表符缩进，
         %m  表示主体消息， 
         %n  表示换行， 
-    *///解析格式化字符串，足额和多个FormatItem对象
+        %r  表示采样率， [%r] → [100]（未采样为 1）
+        %F  表示结构化字段， %m%F → msg user=42 ok=true
+    */
+    // 输出格式：按格式化字符串输出，或者整行输出为 JSON Lines / logfmt
+    enum FormatMode {
+        FORMAT_PATTERN,
+        FORMAT_JSON,
+        FORMAT_LOGFMT
+    };
+    //解析格式化字符串，足额和多个FormatItem对象
     class Formatter{
         public:
+            /* 结构化格式：每条日志输出一行，固定字段 time/level/logger/file/line/tid/msg（线程有名字时多一个 thread，采样时多一个 sample_rate），
+               其后是调用时附带的键值字段；time_fmt 为 strftime 格式 */
+            Formatter(FormatMode mode, const std::string &time_fmt = "%Y-%m-%dT%H:%M:%S")
+                : _mode(mode)
+                , _time_fmt(time_fmt)
+            {
+                if (_mode == FORMAT_PATTERN) {
+                    _pattern = "[%d{%H:%M:%S}][%t][%c][%f:%l][%p]%T%m%F%n";
+                    bool ok = parsePattern();
+                    assert(ok);
+                    (void)ok;
+                }
+            }
             Formatter(const std::string& pattern = "[%d{%H:%M:%S}][%t][%c][%f:%l][%p]%T%m%n")
                 :_pattern(pattern)
+                , _mode(FORMAT_PATTERN)
             {
-                assert(parsePattern());
+                // parsePattern 不能直接写在 assert 里，否则定义 NDEBUG 后不会被调用
+                bool ok = parsePattern();
+                assert(ok);
+                (void)ok;
             }
             //格式化方法1：输出到流
             void format(std::ostream& out, LogMsg& msg){
+                if (structured()) {
+                    out << format(msg);
+                    return;
+                }
                 for (auto &item : _items) {
                     item->format(out, msg);
                 }
             }
             //格式化方法2：返回字符串
             std::string format(LogMsg &msg) {
+                if (structured()) {
+                    std::string out;
+                    formatStructured(out, msg);
+                    return out;
+                }
                 std::ostringstream out;
                 format(out, msg);
                 return out.str();
             }
+            FormatMode mode() const { return _mode; }
+            // 格式化字符串（结构化格式下为时间格式）
+            const std::string &pattern() const { return _mode == FORMAT_PATTERN ? _pattern : _time_fmt; }
+            // JSON / logfmt 格式：异步日志器据此把格式化推迟到工作线程
+            bool structured() const { return _mode != FORMAT_PATTERN; }
             //对格式化字符串进行解析
             /*
             输入->[%d{%H:%M:%S}][%t][%c][%f:%l][%p]%T%m%n
@@ -208,10 +324,90 @@ namespace MySpace{
                 if (key == "T")  return std::make_unique<TabFormatItem>();
                 if (key == "m")  return std::make_unique<payloadFormatItem>();
                 if (key == "n")  return std::make_unique<NewLineFormatItem>();
+                if (key == "r")  return std::make_unique<sampleRateFormatItem>();
+                if (key == "F")  return std::make_unique<fieldsFormatItem>();
+                if (key == "N")  return std::make_unique<threadNameFormatItem>();
                 return std::make_unique<OtherFormatItem>(val);
             }
+            // 直接拼接字符串，不经过 ostream
+            void formatStructured(std::string &out, LogMsg &msg) {
+                bool json = _mode == FORMAT_JSON;
+                char buf[64];
+                struct tm t;
+                localtime_r(&msg._ctime, &t);
+                size_t n = strftime(buf, sizeof(buf), _time_fmt.c_str(), &t);
+                out.reserve(128 + msg._payload.size() + msg._file.size() + msg._fields.size() * 24);
+                out.append(json ? "{\"time\":" : "time=");
+                if (json) Escape::appendJson(out, buf, n);
+                else Escape::appendLogfmt(out, buf, n);
+                out.append(json ? ",\"level\":\"" : " level=");
+                out.append(LogLevel::toString(msg._level));
+                if (json) out.push_back('"');
+                appendKey(out, "logger", json);
+                appendString(out, msg._logger, json);
+                appendKey(out, "file", json);
+                appendString(out, msg._file, json);
+                appendKey(out, "line", json);
+                auto r = std::to_chars(buf, buf + sizeof(buf), msg._line);
+                out.append(buf, r.ptr - buf);
+                appendKey(out, "tid", json);
+                r = std::to_chars(buf, buf + sizeof(buf), msg._tid);
+                out.append(buf, r.ptr - buf);
+                if (!msg._thread_name.empty()) {
+                    appendKey(out, "thread", json);
+                    appendString(out, msg._thread_name, json);
+                }
+                if (msg._sample_rate > 1) {
+                    appendKey(out, "sample_rate", json);
+                    r = std::to_chars(buf, buf + sizeof(buf), msg._sample_rate);
+                    out.append(buf, r.ptr - buf);
+                }
+                appendKey(out, "msg", json);
+                appendString(out, msg._payload, json);
+                for (auto &field : msg._fields) {
+                    appendFieldKey(out, field._key, json);
+                    FieldText::append(out, field, json);
+                }
+                out.append(json ? "}\n" : "\n");
+            }
+            // 输出字段分隔符和键：JSON 为 ,"key": ，logfmt 为 " key="
+            static void appendKey(std::string &out, const std::string &key, bool json) {
+                if (json) {
+                    out.append(",\"");
+                    out.append(key);
+                    out.append("\":");
+                } else {
+                    out.push_back(' ');
+                    out.append(key);
+                    out.push_back('=');
+                }
+            }
+            /* 用户字段的键：和值一样转义（JSON 的键总是加引号，logfmt 含空格、= 等时加引号）；
+               和内置键重名时加 "fields." 前缀，不让用户字段覆盖 time、level、msg 等 */
+            static void appendFieldKey(std::string &out, const std::string &key, bool json) {
+                out.push_back(json ? ',' : ' ');
+                if (isBuiltinKey(key)) {
+                    std::string renamed = "fields." + key;
+                    appendString(out, renamed, json);
+                } else {
+                    appendString(out, key, json);
+                }
+                out.push_back(json ? ':' : '=');
+            }
+            static bool isBuiltinKey(const std::string &key) {
+                static const char *builtin[] = {"time", "level", "logger", "file", "line", "tid", "thread", "sample_rate", "msg"};
+                for (const char *k : builtin)
+                    if (key == k) return true;
+                return false;
+            }
+            static void appendString(std::string &out, const std::string &str, bool json) {
+                if (json) Escape::appendJson(out, str.data(), str.size());
+                else Escape::appendLogfmt(out, str.data(), str.size());
+            }
         private:
             std::string _pattern;//格式化规则字符串
+            FormatMode _mode;    // 输出格式
+            std::string _time_fmt;  // 结构化格式下的时间格式
             std::vector<std::unique_ptr<FormatItem>> _items;// 格式化子项数组
     };
 
@@ -0,0 +1,110 @@
+//index.hpp
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "level.hpp"
+#include "crash.hpp"
+
+#define DEFAULT_INDEX_BLOCK (64 * 1024)//默认每 64K 日志写一条索引
+#define LOG_INDEX_MAGIC "LOGIDX01"
+
+/*
+    滚动日志文件的旁路索引（文件名为 日志文件名 + ".idx"）：日志每写满 block 字节，追加一条索引，
+    记录这一段在日志文件中的位置、时间范围（记录头中的纳秒时间戳）和出现过的等级，
+    查询时（tools/log_query）据此跳过时间不在范围内、或者没有要找的等级的段，只扫描剩下的部分。
+
+    文件格式：16 字节文件头（8 字节 magic + uint32 段大小 + uint32 保留），之后是连续的 IndexEntry。
+    最后一段不满 block 时在关闭文件时写出；进程崩溃时没写出的那一段由查询工具当作未索引部分整段扫描。
+*/
+namespace MySpace{
+    struct IndexHeader {
+        char magic[8];
+        uint32_t block;        // 段大小
+        uint32_t reserved;
+    };
+    struct IndexEntry {
+        uint64_t offset;       // 段在日志文件中的起始偏移
+        uint64_t length;       // 段长度
+        uint64_t min_ts_ns;    // 段内最早的记录时间
+        uint64_t max_ts_ns;    // 段内最晚的记录时间
+        uint32_t records;      // 段内记录数
+        uint32_t level_mask;   // 段内出现过的等级，第 l 位对应 LogLevel::value l
+    };
+
+    class IndexWriter {
+        public:
+            IndexWriter(size_t block = DEFAULT_INDEX_BLOCK) : _block(block) { reset(0); }
+            ~IndexWriter() { close(); }
+            // 开始为一个新的日志文件建索引，offset 为日志文件当前长度
+            bool open(const std::string &log_path, uint64_t offset) {
+                close();
+                std::string path = log_path + ".idx";
+                _fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+                if (_fd < 0) return false;
+                struct stat st;
+                if (fstat(_fd, &st) == 0 && st.st_size == 0) {
+                    IndexHeader header;
+                    memcpy(header.magic, LOG_INDEX_MAGIC, sizeof(header.magic));
+                    header.block = (uint32_t)_block;
+                    header.reserved = 0;
+                    CrashHandler::writeAll(_fd, reinterpret_cast<const char *>(&header), sizeof(header));
+                }
+                reset(offset);
+                return true;
+            }
+            // 登记一条已经写入日志文件的记录；不知道等级时传 OFF，按所有等级都可能出现处理
+            void add(uint64_t ts_ns, LogLevel::value level, size_t len) {
+                if (_fd < 0) return;
+                if (_cur.records == 0 || ts_ns < _cur.min_ts_ns) _cur.min_ts_ns = ts_ns;
+                if (ts_ns > _cur.max_ts_ns) _cur.max_ts_ns = ts_ns;
+                _cur.level_mask |= level == LogLevel::OFF ? 0xFFu : (1u << level);
+                _cur.records++;
+                _cur.length += len;
+                if (_cur.length >= _block) {
+                    flushEntry();
+                    reset(_cur.offset + _cur.length);
+                }
+            }
+            // 写出最后一段并关闭
+            void close() {
+                if (_fd < 0) return;
+                flushEntry();
+                ::close(_fd);
+                _fd = -1;
+            }
+            bool isOpen() const { return _fd >= 0; }
+
+            // 读取日志文件的索引，没有或者格式不对时返回 false
+            static bool read(const std::string &log_path, std::vector<IndexEntry> &entries) {
+                entries.clear();
+                int fd = ::open((log_path + ".idx").c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) return false;
+                IndexHeader header;
+                bool ok = ::read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)
+                    && memcmp(header.magic, LOG_INDEX_MAGIC, sizeof(header.magic)) == 0;
+                IndexEntry entry;
+                while (ok && ::read(fd, &entry, sizeof(entry)) == (ssize_t)sizeof(entry))
+                    entries.push_back(entry);
+                ::close(fd);
+                return ok;
+            }
+        private:
+            void reset(uint64_t offset) {
+                memset(&_cur, 0, sizeof(_cur));
+                _cur.offset = offset;
+            }
+            void flushEntry() {
+                if (_cur.records == 0) return;
+                CrashHandler::writeAll(_fd, reinterpret_cast<const char *>(&_cur), sizeof(_cur));
+            }
+        private:
+            size_t _block;         // 段大小
+            int _fd = -1;          // 索引文件
+            IndexEntry _cur;       // 正在累积的一段
+    };
+}
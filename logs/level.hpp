@@ -9,6 +9,10 @@ namespace MySpace
         enum value { DEBUG, INFO, WARN, ERROR, FATAL, OFF };
 
         static const std::string toString(value level){
+            return toCString(level);
+        }
+        // 不分配内存的版本，信号处理函数中使用
+        static const char *toCString(value level){
             switch (level){
                 case DEBUG: return "DEBUG";
                 case INFO : return "INFO";
@@ -19,5 +23,15 @@ namespace MySpace
             }
             return "UNKNOW";
         }
+        // 从字符串解析等级（不区分大小写），无法识别时返回 false
+        static bool fromString(const std::string &str, value &level){
+            std::string up;
+            for (char c : str) up.push_back((c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c);
+            for (int l = DEBUG; l <= OFF; ++l) {
+                if (up == toString((value)l)) { level = (value)l; return true; }
+            }
+            if (up == "WARNING") { level = WARN; return true; }
+            return false;
+        }
     };
 }
@@ -0,0 +1,158 @@
+//limiter.hpp
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#define LIMITER_MAX_INTERVAL_NS (3600LL * 1000000000LL) // 限流器产生令牌的最长间隔（每小时一个）
+
+/*
+    调用点级别的限流与去重：状态对象以 static 变量的形式放在调用点旁边（见文件末尾的宏），
+    判断只需要几次原子操作，发生在构造 LogMsg 和格式化之前。
+*/
+namespace MySpace{
+    /* 调用点上还没输出的汇总行：开始丢弃时由调用点宏登记到日志器（Logger::deferSummary），
+       日志器 flush 时取走并输出，不必等到同一调用点的下一次放行 */
+    class SummarySource {
+        public:
+            virtual ~SummarySource() {}
+            // 取走尚未汇总的条数对应的汇总行，没有时返回空串
+            virtual std::string takeSummary() = 0;
+    };
+
+    // 令牌桶限流（GCRA 算法，单个原子变量即可表示桶的状态）
+    class RateLimiter : public SummarySource {
+        public:
+            /* per_second: 平均每秒允许的条数， burst: 允许的突发条数
+               per_second 不是正数（含 NaN）或小于每小时 1 条时按每小时 1 条算 */
+            RateLimiter(double per_second, uint32_t burst = 1)
+                : _interval_ns(intervalOf(per_second))
+                , _tolerance_ns((int64_t)std::min<double>((double)_interval_ns * (std::max<uint32_t>(burst, 1) - 1), 4e18))
+                , _tat(0)
+                , _suppressed(0)
+            {}
+            /* 是否允许本次输出；允许时 dropped 返回此前被丢弃的条数，
+               不允许时返回包括本次在内尚未汇总的条数（为 1 时调用方登记到日志器，见 SummarySource） */
+            bool allow(uint64_t &dropped) {
+                int64_t now = nowNs();
+                int64_t tat = _tat.load(std::memory_order_relaxed);
+                while (true) {
+                    int64_t base = std::max(tat, now);
+                    if (base - now > _tolerance_ns) {     // 桶里没有令牌了
+                        dropped = _suppressed.fetch_add(1, std::memory_order_relaxed) + 1;
+                        return false;
+                    }
+                    if (_tat.compare_exchange_weak(tat, base + _interval_ns, std::memory_order_relaxed))
+                        break;
+                }
+                dropped = _suppressed.load(std::memory_order_relaxed) ? _suppressed.exchange(0, std::memory_order_relaxed) : 0;
+                return true;
+            }
+            // 汇总行的内容
+            static std::string summary(uint64_t dropped) {
+                return std::to_string(dropped) + " messages suppressed by rate limit";
+            }
+            std::string takeSummary() override {
+                uint64_t dropped = _suppressed.exchange(0, std::memory_order_relaxed);
+                return dropped ? summary(dropped) : std::string();
+            }
+        private:
+            static int64_t intervalOf(double per_second) {
+                if (!(per_second > 1e9 / LIMITER_MAX_INTERVAL_NS)) return LIMITER_MAX_INTERVAL_NS;
+                return std::max<int64_t>((int64_t)(1e9 / per_second), 1);
+            }
+            static int64_t nowNs() {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+        private:
+            const int64_t _interval_ns;             // 产生一个令牌的间隔
+            const int64_t _tolerance_ns;            // 允许提前的时间（突发量）
+            std::atomic<int64_t> _tat;              // 理论上下一条允许到达的时间
+            std::atomic<uint64_t> _suppressed;      // 被丢弃的条数
+    };
+
+    // 连续重复日志去重：同一调用点连续输出相同内容时只保留第一条，
+    // 内容变化或超过 window_ms 后先输出一行 "last message repeated N times"
+    class Deduplicator : public SummarySource {
+        public:
+            Deduplicator(uint32_t window_ms = 1000)
+                : _window_ns((int64_t)window_ms * 1000000)
+                , _last_hash(0)
+                , _last_emit(0)
+                , _repeats(0)
+            {}
+            /* 是否允许本次输出；允许时 repeats 返回上一条被折叠的重复次数，
+               不允许时返回包括本次在内尚未汇总的次数（为 1 时调用方登记到日志器） */
+            bool allow(const std::string &msg, uint64_t &repeats) {
+                size_t hash = std::hash<std::string>()(msg);
+                size_t prev = _last_hash.exchange(hash, std::memory_order_relaxed);
+                int64_t now = nowNs();
+                if (prev == hash && now - _last_emit.load(std::memory_order_relaxed) < _window_ns) {
+                    repeats = _repeats.fetch_add(1, std::memory_order_relaxed) + 1;
+                    return false;
+                }
+                _last_emit.store(now, std::memory_order_relaxed);
+                repeats = _repeats.exchange(0, std::memory_order_relaxed);
+                return true;
+            }
+            static std::string summary(uint64_t repeats) {
+                return "last message repeated " + std::to_string(repeats) + " times";
+            }
+            std::string takeSummary() override {
+                uint64_t repeats = _repeats.exchange(0, std::memory_order_relaxed);
+                return repeats ? summary(repeats) : std::string();
+            }
+        private:
+            static int64_t nowNs() {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+        private:
+            const int64_t _window_ns;               // 折叠窗口
+            std::atomic<size_t> _last_hash;         // 上一条内容的哈希
+            std::atomic<int64_t> _last_emit;        // 上一次真正输出的时间
+            std::atomic<uint64_t> _repeats;         // 被折叠的次数
+    };
+}
+
+/*
+    调用点宏：限流器/去重器是调用点内的 static 对象（不析构，日志器登记的汇总在进程退出前 flush 时仍可取用），每个调用点各自独立
+    LOG_RATE_LIMIT(logger, MySpace::LogLevel::ERROR, 10, 20, "db timeout");   // 平均每秒 10 条，突发 20 条
+    LOG_DEDUP(logger, MySpace::LogLevel::ERROR, 1000, msg);                    // 1 秒内的连续重复行折叠
+    限流宏在拿到令牌后才对 msg 求值；开始丢弃后，汇总行在下一次放行或日志器 flush 时输出（先到者）
+*/
+#define LOG_RATE_LIMIT(logger, level, per_second, burst, msg) \
+    do { \
+        static MySpace::RateLimiter &_log_limiter_ = *new MySpace::RateLimiter(per_second, burst); \
+        uint64_t _log_dropped_ = 0; \
+        if ((logger)->shouldLog(level)) { \
+            if (_log_limiter_.allow(_log_dropped_)) { \
+                if (_log_dropped_ > 0) \
+                    (logger)->logAt(level, __FILE__, __LINE__, MySpace::RateLimiter::summary(_log_dropped_)); \
+                (logger)->logAt(level, __FILE__, __LINE__, msg); \
+            } else if (_log_dropped_ == 1) { \
+                (logger)->deferSummary(&_log_limiter_, level, __FILE__, __LINE__); \
+            } \
+        } \
+    } while (0)
+
+#define LOG_DEDUP(logger, level, window_ms, msg) \
+    do { \
+        static MySpace::Deduplicator &_log_dedup_ = *new MySpace::Deduplicator(window_ms); \
+        if ((logger)->shouldLog(level)) { \
+            const std::string &_log_msg_ = (msg); \
+            uint64_t _log_repeats_ = 0; \
+            if (_log_dedup_.allow(_log_msg_, _log_repeats_)) { \
+                if (_log_repeats_ > 0) \
+                    (logger)->logAt(level, __FILE__, __LINE__, MySpace::Deduplicator::summary(_log_repeats_)); \
+                (logger)->logAt(level, __FILE__, __LINE__, _log_msg_); \
+            } else if (_log_repeats_ == 1) { \
+                (logger)->deferSummary(&_log_dedup_, level, __FILE__, __LINE__); \
+            } \
+        } \
+    } while (0)
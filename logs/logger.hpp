@@ -6,16 +6,32 @@
 #include <mutex>
 #include <memory>
 #include <atomic>
+#include <chrono>
 #include <condition_variable> 
+#include <deque>
+#include <array>
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
 #include "buffer.hpp"
+#include "crash.hpp"
+#include "limiter.hpp"
+#include "stats.hpp"
 #include "format.hpp"
 #include "level.hpp"
 #include "looper.hpp"
 #include "message.hpp"
+#include "router.hpp"
 #include "sink.hpp"
 #include "util.hpp"
 
+#define DEFAULT_SHUTDOWN_MS 2000 // 有序关闭（含进程退出时）的默认时限
+#define CONFIG_READER_SLOTS 16 // 配置读者计数的分片数
+
 namespace MySpace{
+    using SinkList = std::vector<std::shared_ptr<LogSink>>;
+
     class Logger {
         public:
             Logger(const std::string &logger_name
@@ -24,48 +40,305 @@ namespace MySpace{
                 , std::vector<std::shared_ptr<MySpace::LogSink >> sinks)
                 :_logger_name(logger_name)
                 , _limit_level(limit_level)
-                , _formatter(formatter)
-                , _sinks(sinks.begin(), sinks.end())
-            {}
+                , _flush_level(LogLevel::FATAL)
+                , _formatter(formatter.get())
+                , _sinks(nullptr)
+                , _formatter_owned(formatter)
+                , _sinks_owned(std::make_shared<const SinkList>(sinks.begin(), sinks.end()))
+                , _phase(0)
+                , _id(nextId())
+            {
+                _sinks.store(_sinks_owned.get(), std::memory_order_release);
+                for (auto &slot : _readers) slot.count[0] = slot.count[1] = 0;
+                for (auto &every : _sample_every) every = 1;
+                for (auto &random : _sample_random) random = false;
+            }
+            virtual ~Logger() {}
             //获取日志器名称
             const std::string &name(){ return _logger_name; }
+            //获取日志器编号（进程内唯一，异步缓冲区的记录头中用它代替名字）
+            uint32_t id() const { return (uint32_t)_id; }
+            /* 运行时修改配置：等级是一次原子写；格式化器和落地方向列表按 RCU 方式整体替换指针，
+               记录日志的线程只做一次原子读，不会等待修改者。使用指针期间持有 ReadGuard（分片的读者计数），
+               被替换下来的对象先放进 _retired，等替换之前进入的读者都退出后，在下一次修改配置或 flush 完成时释放。
+               formatter()/sinks() 返回的引用只在下一次修改配置之前有效 */
+            void setLevel(LogLevel::value level) { _limit_level.store(level, std::memory_order_relaxed); }
+            LogLevel::value level() const { return _limit_level.load(std::memory_order_relaxed); }
+            void setFormatter(std::shared_ptr<Formatter> formatter) {
+                {
+                    std::unique_lock<std::mutex> lock(_config_mutex);
+                    _retired.push_back(Retired{_flips, _formatter_owned});
+                    _formatter_owned = formatter;
+                    _formatter.store(formatter.get());
+                }
+                reclaimRetired();
+            }
+            void setSinks(const SinkList &sinks) {
+                {
+                    std::unique_lock<std::mutex> lock(_config_mutex);
+                    _retired.push_back(Retired{_flips, _sinks_owned});
+                    _sinks_owned = std::make_shared<const SinkList>(sinks);
+                    _sinks.store(_sinks_owned.get());
+                }
+                // 让此前的日志在旧的落地方向上写完（flush 完成时会回收）
+                flush();
+            }
+            // 顺序一致的读：与读者计数、修改者检查计数之间构成全序（见 reclaimRetired）
+            Formatter &formatter() const { return *_formatter.load(); }
+            const SinkList &sinks() const { return *_sinks.load(); }
+            // 等级达到 level 的日志写出后立即 flush，设为 OFF 关闭（默认 FATAL）
+            void setFlushLevel(LogLevel::value level) { _flush_level = level; }
+            LogLevel::value flushLevel() const { return _flush_level.load(std::memory_order_relaxed); }
+            /* 挂接飞行记录器：所有等级（包括低于 _limit_level 的）都以二进制编码记录进内存，出错时才格式化落盘
+               可以在记录日志的同时替换或摘掉（传空），被替换下来的记录器和格式化器一样在读者退出后回收 */
+            void setFlightRecorder(std::shared_ptr<FlightRecorderSink> recorder) {
+                {
+                    std::unique_lock<std::mutex> lock(_config_mutex);
+                    _retired.push_back(Retired{_flips, _recorder_owned});
+                    _recorder_owned = recorder;
+                    _recorder.store(recorder.get());
+                }
+                reclaimRetired();
+            }
+            /* 对 level 等级的日志做 1/every 采样：random 为 false 时每个线程每 every 条取 1 条，
+               为 true 时每条以 1/every 的概率保留。every <= 1 关闭采样。
+               被采样掉的调用只更新一个线程局部计数器，采中的日志通过 %r 带出采样率。level 不是 DEBUG~FATAL 时返回 false */
+            bool setSampling(LogLevel::value level, uint32_t every, bool random = false) {
+                if (level < LogLevel::DEBUG || level >= LogLevel::OFF)
+                    return false;
+                _sample_random[level] = random;
+                _sample_every[level] = every > 1 ? every : 1;
+                return true;
+            }
+            /* 阻塞直到此前的日志全部经过所有落地方向并刷新，超时返回 false；完成后回收被替换下来的配置 */
+            virtual bool flush(std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) = 0;
             /* 构造日志消息对象过程， 并得到格式化后的日志消息字符串-- 然后进行落地输出*/
-            void debug(const std::string& file, size_t line, const std::string &fmtStr){
-                logMessage(LogLevel::DEBUG, file, line, fmtStr);
+            void debug(const std::string& file, size_t line, const std::string &fmtStr, std::initializer_list<LogField> fields = {}){
+                logMessage(LogLevel::DEBUG, file, line, fmtStr, fields);
             }
-            void info(const std::string& file, size_t line, const std::string &fmtStr){
-                logMessage(LogLevel::INFO, file, line, fmtStr);
+            void info(const std::string& file, size_t line, const std::string &fmtStr, std::initializer_list<LogField> fields = {}){
+                logMessage(LogLevel::INFO, file, line, fmtStr, fields);
             }
-            void warn(const std::string& file, size_t line, const std::string &fmtStr){
-                logMessage(LogLevel::WARN, file, line, fmtStr);
+            void warn(const std::string& file, size_t line, const std::string &fmtStr, std::initializer_list<LogField> fields = {}){
+                logMessage(LogLevel::WARN, file, line, fmtStr, fields);
             }
-            void error(const std::string& file, size_t line, const std::string &fmtStr){
-                logMessage(LogLevel::ERROR, file, line, fmtStr);
+            void error(const std::string& file, size_t line, const std::string &fmtStr, std::initializer_list<LogField> fields = {}){
+                logMessage(LogLevel::ERROR, file, line, fmtStr, fields);
             }
-            void fatal(const std::string& file, size_t line, const std::string &fmtStr){
-                logMessage(LogLevel::FATAL, file, line, fmtStr);
+            void fatal(const std::string& file, size_t line, const std::string &fmtStr, std::initializer_list<LogField> fields = {}){
+                logMessage(LogLevel::FATAL, file, line, fmtStr, fields);
             }
-        protected:
-            void logMessage(MySpace::LogLevel::value level, const std::string& file, size_t line, const std::string &message) {
-                /* 通过传入的参数构造出一个日志消息对象，进行日志格式化，最终落地*/
-                // 1、 判断当前日志等级是否达到输出标准
-                if (level < _limit_level)  
-                    return;
+            /* 指定等级输出，供 LOG_RATE_LIMIT / LOG_DEDUP 等调用点宏使用 */
+            void logAt(LogLevel::value level, const std::string& file, size_t line, const std::string &fmtStr
+                , std::initializer_list<LogField> fields = {}){
+                logMessage(level, file, line, fmtStr, fields);
+            }
+            /* 登记调用点上尚未输出的汇总行（LOG_RATE_LIMIT / LOG_DEDUP 开始丢弃时调用），下一次 flush 时输出；
+               source 须在日志器 flush 之前一直有效（调用点宏里的对象不析构） */
+            void deferSummary(SummarySource *source, LogLevel::value level, const char *file, size_t line) {
+                std::unique_lock<std::mutex> lock(_summary_mutex);
+                _summaries.push_back(DeferredSummary{source, level, file, line});
+            }
+            /* 该等级的日志是否会被处理（调用点宏据此在限流判断之前先过滤） */
+            bool shouldLog(LogLevel::value level) const {
+                return level >= _limit_level || _recorder.load(std::memory_order_relaxed);
+            }
+            /* 过滤、采样并格式化一条日志，把要交给落地的数据放进 out；返回 false 表示这条日志不需要落地。
+               协程接口（coro.hpp）在调用线程中先 render，再用 tryLog 非阻塞地写入 */
+            bool render(MySpace::LogLevel::value level, const std::string& file, size_t line, const std::string &message
+                , std::initializer_list<LogField> fields, std::string &out) {
+                // 1、 判断当前日志等级是否达到输出标准（挂了飞行记录器时所有等级都要记录）
+                if (level < _limit_level && !_recorder.load(std::memory_order_relaxed)) {
+                    _filtered.add();
+                    return false;
+                }
+                // 采样：在构造 LogMsg 之前决定是否丢弃
+                uint32_t every = level < LogLevel::OFF ? _sample_every[level].load(std::memory_order_relaxed) : 1;
+                if (every > 1 && !sampled(level, every))
+                    return false;
                 // 2、 构造LogMsg对象
                 LogMsg msg(level, line, file, _logger_name, message);
+                msg._sample_rate = every;
+                if (fields.size()) msg._fields.assign(fields.begin(), fields.end());
                 // 3、 通过格式化工具对LogMsg进行格式化，获得格式化后的日志字符串
-                std::string real_message = _formatter->format(msg);
+                //     异步 + 结构化格式时只做二进制编码，由工作线程格式化
+                //     飞行记录器只保存二进制编码，dump 时才格式化，低于等级阈值的日志在这里不做格式化
+                if (_recorder.load(std::memory_order_relaxed)) {
+                    {
+                        ReadGuard guard(*this);
+                        if (FlightRecorderSink *recorder = _recorder.load()) recorder->record(msg);
+                    }
+                    if (level < _limit_level) {
+                        _filtered.add();
+                        return false;
+                    }
+                }
+                if (defersFormatting()) msg.encode(out);
+                else {
+                    ReadGuard guard(*this);
+                    out = formatter().format(msg);
+                }
+                _logged.add();
+                _bytes_formatted.add(out.size());
+                return true;
+            }
+            /* 非阻塞落地：能立即写入时返回 true；否则返回 false，记录写入后调用一次 wake（在日志器的工作线程中）。
+               返回 false 时 data 必须保持有效直到 wake 被调用。同步日志器直接写出 */
+            virtual bool tryLog(LogLevel::value level, const char *data, size_t len, std::function<void()> wake) {
+                (void)wake;
+                log(level, data, len);
+                return true;
+            }
+            /* 非阻塞 flush：已经完成时返回 true；否则返回 false，完成后调用一次 wake（在日志器的工作线程中） */
+            virtual bool tryFlush(std::function<void()> wake) {
+                (void)wake;
+                flush();
+                return true;
+            }
+            /* 日志器自身占用的缓冲区内存（字节）；同步日志器不持有缓冲区 */
+            virtual size_t memoryFootprint() { return 0; }
+            /* 统计快照：各阶段计数、异步缓冲区与批处理情况、各落地方向的耗时和错误 */
+            virtual LoggerStatsSnapshot stats() {
+                LoggerStatsSnapshot s;
+                s.logger = _logger_name;
+                s.filtered = _filtered.value();
+                s.memory_bytes = memoryFootprint();
+                s.logged = _logged.value();
+                s.bytes_formatted = _bytes_formatted.value();
+                ReadGuard guard(*this);
+                for (auto &sink : sinks()) s.sinks.push_back(sink->stats());
+                return s;
+            }
+        protected:
+            /* 读者计数：持有期间 formatter()/sinks() 取到的对象不会被释放。
+               计数按线程散列到 CONFIG_READER_SLOTS 个分片，每个分片按当前阶段分两个计数 */
+            class ReadGuard {
+                public:
+                    explicit ReadGuard(const Logger &logger) {
+                        static thread_local size_t slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % CONFIG_READER_SLOTS;
+                        _count = &logger._readers[slot].count[logger._phase.load() & 1];
+                        _count->fetch_add(1);
+                    }
+                    ~ReadGuard() { _count->fetch_sub(1, std::memory_order_release); }
+                    ReadGuard(const ReadGuard &) = delete;
+                    ReadGuard &operator=(const ReadGuard &) = delete;
+                private:
+                    std::atomic<uint32_t> *_count;
+            };
+            /* 回收被替换下来的配置，不等待读者：上一阶段的读者都已退出时切换阶段（最多两次），
+               替换后经过两次切换的对象就不会再有读者。读者先计数再读指针，切换之后才计数的读者只会读到新指针 */
+            void reclaimRetired() {
+                std::unique_lock<std::mutex> lock(_config_mutex);
+                for (int i = 0; i < 2 && !_retired.empty(); ++i) {
+                    uint32_t previous = (_phase.load() + 1) & 1;
+                    for (auto &slot : _readers) {
+                        if (slot.count[previous].load() != 0) return;
+                    }
+                    _phase.fetch_add(1);
+                    ++_flips;
+                    while (!_retired.empty() && _retired.front().flips + 2 <= _flips)
+                        _retired.pop_front();
+                }
+            }
+            void logMessage(MySpace::LogLevel::value level, const std::string& file, size_t line, const std::string &message
+                , std::initializer_list<LogField> fields = {}) {
+                /* 通过传入的参数构造出一个日志消息对象，进行日志格式化，最终落地*/
+                // 结构化编码复用线程局部的缓冲区；文本用局部变量，落地方向里再记日志（重入）也不会互相覆盖
+                static thread_local std::string encoded;
+                std::string text;
+                std::string &out = defersFormatting() ? encoded : text;
+                if (!render(level, file, line, message, fields, out))
+                    return;
                 // 4、 进行日志落地
-                log(real_message.c_str(), real_message.size());
+                log(level, out.data(), out.size());
+                // 5、 严重等级的日志立即刷新，保证进程随后退出/崩溃时日志不丢
+                if (level >= _flush_level)
+                    flush();
+            }
+            /* 采样判断，只访问线程局部状态；每个线程按日志器编号（不复用）各有一组计数器，
+               连续记录同一个日志器时不查表 */
+            bool sampled(LogLevel::value level, uint32_t every) {
+                if (_sample_random[level].load(std::memory_order_relaxed)) {
+                    static thread_local uint64_t seed = (uint64_t)(uintptr_t)&seed * 0x9E3779B97F4A7C15ull | 1;
+                    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;   // xorshift64
+                    return seed % every == 0;
+                }
+                using Counters = std::array<uint32_t, LogLevel::OFF>;
+                struct Local {
+                    size_t id = 0;              // 上一次使用的日志器
+                    Counters *counters = nullptr;
+                    std::unordered_map<size_t, Counters> all;
+                };
+                static thread_local Local local;
+                if (local.id != _id) {
+                    local.counters = &local.all[_id];     // 新插入的计数器为 0；unordered_map 的元素地址不随插入改变
+                    local.id = _id;
+                }
+                return (*local.counters)[level]++ % every == 0;
+            }
+            /* flush 时调用：等待飞行记录器中已触发的 dump 完成 */
+            void flushRecorder() {
+                ReadGuard guard(*this);
+                if (FlightRecorderSink *recorder = _recorder.load()) recorder->flush();
+            }
+            /* flush 开始时调用：输出登记过、还没被下一次放行带出的汇总行 */
+            void flushSummaries() {
+                std::vector<DeferredSummary> summaries;
+                {
+                    std::unique_lock<std::mutex> lock(_summary_mutex);
+                    if (_summaries.empty()) return;
+                    summaries.swap(_summaries);
+                }
+                for (auto &s : summaries) {
+                    std::string text = s.source->takeSummary();
+                    if (!text.empty()) logMessage(s.level, s.file, s.line, text, {});
+                }
             }
+            static size_t nextId() {
+                static std::atomic<size_t> id(0);
+                return ++id;     // 从 1 开始，0 留给"未知"
+            }
+            /* 为 true 时交给 log() 的是 LogMsg::encode() 的结果，由日志器自己在后台格式化 */
+            virtual bool defersFormatting() const { return false; }
             /* 抽象接口完成实际的落地输出 -- 不同的日志器会有不同的实际落地方式 */
-            virtual void log(const std::string& data, size_t len) = 0;
+            virtual void log(LogLevel::value level, const char *data, size_t len) = 0;
         protected:
             std::mutex _mutex;
             std::string _logger_name;
             std::atomic<MySpace::LogLevel::value> _limit_level;    
-            std::shared_ptr<MySpace::Formatter> _formatter;//使用shared_ptr，因为Formatter是可拷贝的
-            std::vector<std::shared_ptr<MySpace::LogSink>> _sinks;
+            std::atomic<MySpace::LogLevel::value> _flush_level;    // 达到该等级立即刷新
+            std::atomic<MySpace::Formatter *> _formatter;          // 当前格式化器
+            std::atomic<const SinkList *> _sinks;                   // 当前落地方向列表
+            std::mutex _config_mutex;                               // 只在修改配置时使用
+            std::shared_ptr<MySpace::Formatter> _formatter_owned;   // 当前格式化器
+            std::shared_ptr<const SinkList> _sinks_owned;           // 当前落地方向列表
+            struct Retired {
+                uint64_t flips;                                     // 替换下来时的阶段切换次数
+                std::shared_ptr<const void> object;
+            };
+            std::deque<Retired> _retired;                           // 被替换下来、可能还有读者的配置
+            struct alignas(64) ReaderSlot {
+                std::atomic<uint32_t> count[2];
+            };
+            mutable ReaderSlot _readers[CONFIG_READER_SLOTS];       // 各分片在两个阶段的读者数
+            std::atomic<uint32_t> _phase;                           // 当前阶段，新读者计入 _phase & 1
+            uint64_t _flips = 0;                                    // 阶段切换次数
+            std::atomic<MySpace::FlightRecorderSink *> _recorder{nullptr};  // 当前飞行记录器，可为空
+            std::shared_ptr<MySpace::FlightRecorderSink> _recorder_owned;
+            size_t _id;                                              // 日志器编号
+            std::atomic<uint32_t> _sample_every[LogLevel::OFF];      // 各等级的采样间隔，1 表示不采样
+            std::atomic<bool> _sample_random[LogLevel::OFF];         // 各等级是否按概率采样
+            ShardedCounter _filtered;                                // 被等级过滤的调用数
+            ShardedCounter _logged;                                  // 输出的日志条数
+            ShardedCounter _bytes_formatted;                         // 格式化产生的字节数
+            struct DeferredSummary {
+                SummarySource *source;
+                LogLevel::value level;
+                const char *file;
+                size_t line;
+            };
+            std::mutex _summary_mutex;
+            std::vector<DeferredSummary> _summaries;                 // 等待 flush 输出的汇总行
     };
 
     enum LoggerType {
@@ -81,13 +354,30 @@ namespace MySpace{
             , std::vector<std::shared_ptr<MySpace::LogSink>> sinks)
             : Logger(logger_name, limit_level, formatter, sinks)
         {}
+        /* 同步日志器没有待写的缓冲，直接在调用线程中刷新各落地方向，不受时限约束（忽略 timeout），总是返回 true */
+        bool flush(std::chrono::milliseconds = std::chrono::milliseconds(1000)) override {
+            flushSummaries();
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                ReadGuard guard(*this);
+                for (auto &sink : sinks()) {
+                    sink->flush();
+                }
+            }
+            flushRecorder();
+            reclaimRetired();
+            return true;
+        }
     protected:
-        /* 同步日志器，是将日志直接通过落地模块 句柄进行日志落地 */
-        void log(const std::string& data, size_t len) override{
-            std::unique_lock<std::mutex> lock(_mutex);
-            if (_sinks.empty()) return;
-            for (auto &sink : _sinks) {
-                sink->log(data, len);
+        /* 同步日志器，是将日志直接通过落地模块 句柄进行日志落地
+           能并发写的落地方向（concurrentSafe）不加锁直接写，其余的仍在 _mutex 保护下写 */
+        void log(LogLevel::value level, const char *data, size_t len) override{
+            std::unique_lock<std::mutex> lock(_mutex, std::defer_lock);
+            ReadGuard guard(*this);
+            for (auto &sink : sinks()) {
+                if (level < sink->level()) continue;
+                if (!sink->concurrentSafe() && !lock.owns_lock()) lock.lock();
+                sink->writeRecord(level, data, len);
             }
         }
     };
@@ -97,26 +387,118 @@ namespace MySpace{
             AsynchLogger(const std::string &logger_name
                 , LogLevel::value level
                 , std::shared_ptr<Formatter> formatter
-                , std::vector<std::shared_ptr<LogSink>> sinks)
+                , std::vector<std::shared_ptr<LogSink>> sinks
+                , const LooperOptions &options = LooperOptions())
                 : Logger(logger_name, level, formatter, sinks)
-                , _looper(std::make_shared<AsynchLooper>([this](Buffer &buf) { realLog(buf); }))
-            {}
+                , _deferred(formatter->structured())
+                , _pool(std::make_shared<ChunkPool>())
+                , _render(_pool)
+                , _looper(std::make_shared<AsynchLooper>([this](Buffer &buf) { realLog(buf); }, threadOptions(logger_name, options)
+                    , [this]() { realFlush(); }, _pool))
+            {
+                // 登记崩溃回调，进程崩溃时把生产缓冲区中的日志直接写出
+                _crash_slot = CrashHandler::registerDrain(&AsynchLogger::crashDrain, this);
+            }
+            ~AsynchLogger() {
+                CrashHandler::unregisterDrain(_crash_slot);
+            }
+            bool flush(std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) override {
+                flushSummaries();
+                bool done = _looper->flush(timeout);
+                flushRecorder();
+                if (done) reclaimRetired();
+                return done;
+            }
+            // 块池（含 _render 的块）+ 记录索引；空闲 idle_trim_ms 后回落到接近 0
+            size_t memoryFootprint() override { return _looper->memoryFootprint(); }
+            LoggerStatsSnapshot stats() override {
+                LoggerStatsSnapshot s = Logger::stats();
+                const LooperStats &ls = _looper->stats();
+                s.asynch = true;
+                s.producer_waits = ls.producer_waits.load(std::memory_order_relaxed);
+                s.producer_wait_ns = ls.producer_wait_ns.snapshot();
+                s.buffer_swaps = ls.buffer_swaps.load(std::memory_order_relaxed);
+                s.batch_bytes = ls.batch_bytes.snapshot();
+                s.batch_records = ls.batch_records.snapshot();
+                s.buffer_high_water = ls.high_water.load(std::memory_order_relaxed);
+                s.buffer_capacity = ls.capacity.load(std::memory_order_relaxed);
+                s.idle_trims = ls.idle_trims.load(std::memory_order_relaxed);
+                return s;
+            }
 
             /* 将数据写入缓冲区*/
-            virtual void log(const std::string& data, size_t len) override{
-                _looper->push(data.c_str(), len);
+            virtual void log(LogLevel::value level, const char *data, size_t len) override{
+                _looper->push(data, len, level, id());
+            }
+            /* 缓冲区满时不阻塞，由工作线程交换缓冲区后写入并唤醒 */
+            bool tryLog(LogLevel::value level, const char *data, size_t len, std::function<void()> wake) override {
+                return _looper->tryPush(data, len, level, id(), std::move(wake));
+            }
+            bool tryFlush(std::function<void()> wake) override {
+                return _looper->tryFlush(std::move(wake));
             }
 
             /* 设计一个实际落地函数（将缓冲区中的数据落地） */
             void realLog(Buffer &buf) {
-                if (_sinks.empty()) return;
-                for (auto &sink : _sinks) {
-                    sink->log(buf.begin(), buf.readAbleSize());
+                ReadGuard guard(*this);
+                if (sinks().empty()) return;
+                if (_deferred) {
+                    renderDeferred(buf);
+                    dispatch(_render);
+                    _render.bufferReset();
+                    return;
                 }
+                dispatch(buf);
+            }
+            /* 刷新所有落地方向（在工作线程中调用） */
+            void realFlush() {
+                ReadGuard guard(*this);
+                for (auto &sink : sinks()) {
+                    sink->flush();
+                }
+            }
+        protected:
+            bool defersFormatting() const override { return _deferred; }
+        private:
+            /* 整批交给各落地方向，由落地方向按自己的等级取用（LogSink::logRecords） */
+            void dispatch(Buffer &buf) {
+                for (auto &sink : sinks()) {
+                    sink->writeBatch(buf);
+                }
+            }
+            /* 结构化格式：逐条解码生产者写入的 LogMsg 编码，在工作线程中格式化成文本放进 _render */
+            void renderDeferred(Buffer &buf) {
+                LogMsg msg(LogLevel::DEBUG, 0, "", "", "");
+                for (size_t i = 0; i < buf.recordCount(); ++i) {
+                    const RecordMeta &rec = buf.record(i);
+                    if (!msg.decode(rec.data, rec.len)) continue;
+                    std::string text = formatter().format(msg);
+                    _render.push(text.data(), text.size(), rec.level, rec.logger_id, rec.ts_ns);
+                }
+            }
+            // 未指定线程名时用 "log:日志器名"，在 top -H / perf 中能认出是哪个日志器的工作线程
+            static LooperOptions threadOptions(const std::string &logger_name, LooperOptions options) {
+                if (options.thread_name.empty()) options.thread_name = "log:" + logger_name;
+                return options;
+            }
+            // 信号处理函数中调用：只做异步信号安全的写
+            static void crashDrain(void *arg) {
+                AsynchLogger *self = static_cast<AsynchLogger *>(arg);
+                // 结构化格式下缓冲区中是未格式化的二进制编码，信号处理函数中无法安全地格式化，只能放弃
+                if (self->_deferred) return;
+                self->_looper->emergencyDrain([self](const char *data, size_t len) {
+                    for (auto &sink : self->sinks()) {
+                        sink->signalSafeWrite(data, len);
+                    }
+                });
             }
         
         private: 
+            bool _deferred;         // 格式化是否推迟到工作线程（结构化格式）
+            std::shared_ptr<ChunkPool> _pool;   // 工作器的两个缓冲区和 _render 共用的块池
+            Buffer _render;         // 工作线程格式化结构化日志用的缓冲区
             std::shared_ptr<AsynchLooper> _looper;
+            int _crash_slot = -1;   // 崩溃回调槽位
     };
     
     
@@ -129,15 +511,7 @@ namespace MySpace{
             LogLevel::value level = LogLevel::DEBUG,
             const std::string &pattern = "")
         {
-            auto formatter = pattern.empty() ? 
-                std::make_shared<Formatter>() : 
-                std::make_shared<Formatter>(pattern);
-            
-            std::vector<std::shared_ptr<LogSink>> sinks = {
-                std::make_shared<StdoutSink>()
-            };
-            
-            return std::make_shared<SynchLogger>(name, level, formatter, sinks);
+            return std::make_shared<SynchLogger>(name, level, makeFormatter(pattern), defaultSinks({}));
         }
         
         // 创建同步日志器（带自定义 sinks）
@@ -147,15 +521,7 @@ namespace MySpace{
             const std::string &pattern,
             const std::vector<std::shared_ptr<LogSink>> &sinks)
         {
-            auto formatter = pattern.empty() ? 
-                std::make_shared<Formatter>() : 
-                std::make_shared<Formatter>(pattern);
-            
-            auto final_sinks = sinks.empty() ? 
-                std::vector<std::shared_ptr<LogSink>>{std::make_shared<StdoutSink>()} : 
-                sinks;
-            
-            return std::make_shared<SynchLogger>(name, level, formatter, final_sinks);
+            return std::make_shared<SynchLogger>(name, level, makeFormatter(pattern), defaultSinks(sinks));
         }
         
         // 创建异步日志器
@@ -164,34 +530,202 @@ namespace MySpace{
             LogLevel::value level = LogLevel::DEBUG,
             const std::string &pattern = "")
         {
-            auto formatter = pattern.empty() ? 
-                std::make_shared<Formatter>() : 
-                std::make_shared<Formatter>(pattern);
-            
-            std::vector<std::shared_ptr<LogSink>> sinks = {
-                std::make_shared<StdoutSink>()
-            };
-            
-            return std::make_shared<AsynchLogger>(name, level, formatter, sinks);
+            return std::make_shared<AsynchLogger>(name, level, makeFormatter(pattern), defaultSinks({}));
         }
         
-        // 创建异步日志器（带自定义 sinks）
+        // 创建异步日志器（带自定义 sinks，可选消费线程唤醒策略）
         static std::shared_ptr<Logger> createAsynchLogger(
             const std::string &name,
             LogLevel::value level,
             const std::string &pattern,
-            const std::vector<std::shared_ptr<LogSink>> &sinks)
+            const std::vector<std::shared_ptr<LogSink>> &sinks,
+            const LooperOptions &options = LooperOptions())
         {
-            auto formatter = pattern.empty() ? 
-                std::make_shared<Formatter>() : 
-                std::make_shared<Formatter>(pattern);
-            
-            auto final_sinks = sinks.empty() ? 
-                std::vector<std::shared_ptr<LogSink>>{std::make_shared<StdoutSink>()} : 
-                sinks;
-            
-            return std::make_shared<AsynchLogger>(name, level, formatter, final_sinks);
+            return std::make_shared<AsynchLogger>(name, level, makeFormatter(pattern), defaultSinks(sinks), options);
+        }
+
+        // 创建异步日志器（默认落地方向，指定唤醒策略和工作线程属性：绑核、线程名、nice/调度策略、忙轮询）
+        static std::shared_ptr<Logger> createAsynchLogger(
+            const std::string &name,
+            LogLevel::value level,
+            const std::string &pattern,
+            const LooperOptions &options)
+        {
+            return std::make_shared<AsynchLogger>(name, level, makeFormatter(pattern), defaultSinks({}), options);
+        }
+
+        // 创建按路由表取落地方向的日志器：落地方向在这里由 RouteTable 解析一次，
+        // 之后的日志直接写到解析出的共享落地方向上；没有命中任何路由时退回标准输出
+        static std::shared_ptr<Logger> createRoutedLogger(
+            const std::string &name,
+            LoggerType type = LoggerType::LOGGER_SYNCH,
+            LogLevel::value level = LogLevel::DEBUG,
+            const std::string &pattern = "",
+            const LooperOptions &options = LooperOptions())
+        {
+            auto sinks = RouteTable::getInstance().resolve(name);
+            if (sinks.empty()) sinks.push_back(SinkRegistry::getInstance().stdout_());
+            if (type == LoggerType::LOGGER_ASYNCH)
+                return std::make_shared<AsynchLogger>(name, level, makeFormatter(pattern), sinks, options);
+            return std::make_shared<SynchLogger>(name, level, makeFormatter(pattern), sinks);
+        }
+    private:
+        static std::shared_ptr<Formatter> makeFormatter(const std::string &pattern) {
+            return pattern.empty() ? std::make_shared<Formatter>() : std::make_shared<Formatter>(pattern);
+        }
+        static std::vector<std::shared_ptr<LogSink>> defaultSinks(const std::vector<std::shared_ptr<LogSink>> &sinks) {
+            if (!sinks.empty()) return sinks;
+            return std::vector<std::shared_ptr<LogSink>>{std::make_shared<StdoutSink>()};
+        }
+    };
+
+    /* 日志器管理器（单例）：按名称登记日志器，供全局接口 getLogger/rootLogger 和配置热加载使用 */
+    class LoggerManager {
+    public:
+        static LoggerManager &getInstance() {
+            // SinkRegistry 必须先于 manager 构造：静态对象按构造的逆序析构，退出时 shutdown 还要用它
+            SinkRegistry::getInstance();
+            static LoggerManager manager;
+            // 在 manager 构造完成之后登记，保证进程退出时先于 manager 的析构执行
+            static bool at_exit = (std::atexit(&LoggerManager::shutdownAtExit), true);
+            (void)at_exit;
+            return manager;
+        }
+        // 登记日志器，同名的会被替换
+        void addLogger(const std::shared_ptr<Logger> &logger) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _loggers[logger->name()] = logger;
+        }
+        bool hasLogger(const std::string &name) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            return _loggers.find(name) != _loggers.end();
+        }
+        // 取指定名称的日志器，不存在时返回空
+        std::shared_ptr<Logger> getLogger(const std::string &name) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            auto it = _loggers.find(name);
+            return it == _loggers.end() ? nullptr : it->second;
+        }
+        // 默认日志器：名称为 root 的同步标准输出日志器
+        std::shared_ptr<Logger> rootLogger() { return _root; }
+        // 当前登记的所有日志器（含 root）
+        std::vector<std::shared_ptr<Logger>> loggers() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            std::vector<std::shared_ptr<Logger>> all;
+            for (auto &it : _loggers) all.push_back(it.second);
+            return all;
+        }
+        /* 有序关闭：在 deadline 内
+             1、 同时 flush 所有登记的日志器（异步日志器的缓冲区写进各落地方向），然后放开管理器持有的引用
+             2、 刷新并放开 SinkRegistry 中的共享落地方向（日志器已经不再往里写）
+             3、 刷新 root（保留，之后的日志仍然能输出）
+           全部按时完成返回 true。没能按时 flush 的日志器不再析构（析构会等工作线程写完），留给进程退出。
+           使用者仍持有引用的日志器照常可用，只是不再登记在管理器中 */
+        bool shutdown(std::chrono::milliseconds deadline = std::chrono::milliseconds(DEFAULT_SHUTDOWN_MS)) {
+            auto end = std::chrono::steady_clock::now() + deadline;
+            std::vector<std::shared_ptr<Logger>> all;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                for (auto &it : _loggers)
+                    if (it.second != _root) all.push_back(it.second);
+                _loggers.clear();
+                _loggers[_root->name()] = _root;
+            }
+            // 同时发起所有日志器的 flush（tryFlush），再一起等到 deadline，卡住的日志器不影响其他日志器
+            struct FlushWait {
+                std::mutex mutex;
+                std::condition_variable cond;
+                std::vector<bool> done;
+                size_t left;
+            };
+            // 卡住的日志器可能在 shutdown 返回之后才调用 wake，所以用 shared_ptr
+            auto wait = std::make_shared<FlushWait>();
+            wait->done.assign(all.size(), false);
+            wait->left = all.size();
+            for (size_t i = 0; i < all.size(); ++i) {
+                auto mark = [wait, i]() {
+                    std::unique_lock<std::mutex> lock(wait->mutex);
+                    wait->done[i] = true;
+                    wait->left--;
+                    wait->cond.notify_all();
+                };
+                if (all[i]->tryFlush(mark)) mark();
+            }
+            bool ok;
+            {
+                std::unique_lock<std::mutex> lock(wait->mutex);
+                ok = wait->cond.wait_until(lock, end, [&]() { return wait->left == 0; });
+                for (size_t i = 0; i < all.size(); ++i)
+                    if (!wait->done[i]) leaked().push_back(all[i]);
+            }
+            all.clear();
+            ok = SinkRegistry::getInstance().clear(end) && ok;
+            _root->flush();
+            return ok;
+        }
+        // 进程退出时 shutdown 的时限，0 表示退出时不做有序关闭
+        void setExitDeadline(std::chrono::milliseconds deadline) { _exit_deadline_ms = deadline.count(); }
+    private:
+        static void shutdownAtExit() {
+            LoggerManager &manager = getInstance();
+            long long deadline = manager._exit_deadline_ms.load();
+            if (deadline > 0) manager.shutdown(std::chrono::milliseconds(deadline));
+        }
+        static std::vector<std::shared_ptr<Logger>> &leaked() {
+            static auto *loggers = new std::vector<std::shared_ptr<Logger>>();
+            return *loggers;
+        }
+        LoggerManager()
+            : _root(LoggerFactory::createSynchLogger("root"))
+        {
+            _loggers[_root->name()] = _root;
+        }
+        LoggerManager(const LoggerManager &) = delete;
+        LoggerManager &operator=(const LoggerManager &) = delete;
+    private:
+        std::mutex _mutex;
+        std::shared_ptr<Logger> _root;
+        std::unordered_map<std::string, std::shared_ptr<Logger>> _loggers;
+        std::atomic<long long> _exit_deadline_ms{DEFAULT_SHUTDOWN_MS};
+    };
+
+    /* 定时把日志器的统计快照写到指定落地方向（建议使用单独的落地方向，避免和日志器自身并发写） */
+    class StatsReporter {
+    public:
+        StatsReporter(std::shared_ptr<Logger> logger
+            , std::shared_ptr<LogSink> sink
+            , std::chrono::milliseconds interval = std::chrono::milliseconds(10000))
+            : _logger(logger)
+            , _sink(sink)
+            , _interval(interval)
+            , _stop(false)
+            , _thread(&StatsReporter::threadEntry, this)
+        {}
+        ~StatsReporter() {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _cond.notify_all();
+            _thread.join();
+        }
+    private:
+        void threadEntry() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_cond.wait_for(lock, _interval, [this]() { return _stop; })) {
+                std::string line = _logger->stats().toString();
+                _sink->write(line.c_str(), line.size());
+                _sink->flush();
+            }
         }
+    private:
+        std::shared_ptr<Logger> _logger;
+        std::shared_ptr<LogSink> _sink;
+        std::chrono::milliseconds _interval;
+        bool _stop;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::thread _thread;
     };
 
 
@@ -6,72 +6,439 @@
 #include <mutex>
 #include <memory>
 #include <atomic>
+#include <chrono>
 #include <functional>
-#include <condition_variable> 
+#include <condition_variable>
+#include <new>
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include "buffer.hpp"
+#include "fork.hpp"
 #include "format.hpp"
 #include "level.hpp"
 #include "message.hpp"
 #include "sink.hpp"
 #include "util.hpp"
+#include "stats.hpp"
 
 
 namespace MySpace{
+  // 消费线程的唤醒策略：攒够 batch_bytes 字节或者等待超过 max_wait_us 微秒（先到者为准）才交换缓冲区
+  struct LooperOptions {
+    size_t batch_bytes = 0;       // 攒批字节数，0 表示有数据就立即处理（原有行为）
+    size_t max_wait_us = 1000;    // 数据不足 batch_bytes 时最多再等待多久（微秒）
+    size_t spin_count  = 0;       // 挂起前的自旋检查次数，0 表示不自旋直接挂起
+    size_t idle_trim_ms = 5000;   // 连续空闲这么久后把缓存的块和记录索引还给系统，0 表示从不回收
+    // 消费线程的属性：避免和处理请求的线程抢同一批核、方便在 top/perf 中辨认
+    std::vector<int> cpu_affinity;        // 绑定到这些 CPU，空表示不绑定
+    std::string thread_name;              // 线程名（最长 15 字节，超出截断），空时由使用者取默认名
+    int nice = 0;                         // 只作用于消费线程的 nice 值，0 表示不修改
+    int sched_policy = SCHED_OTHER;       // 调度策略：SCHED_BATCH/SCHED_IDLE，或需要 CAP_SYS_NICE 的 SCHED_FIFO/SCHED_RR
+    int sched_priority = 0;               // SCHED_FIFO/SCHED_RR 的优先级
+    bool busy_poll = false;               // 忙轮询：消费线程从不挂起，一直检查生产缓冲区，适合独占一个核；不做空闲回收
+  };
+
   class AsynchLooper {
     public:
-      AsynchLooper(const std::function<void(Buffer &)> &cb) 
-        :_stop(false)
+      // pool 为空时自己创建；使用者自己的缓冲区也可以共用同一个池，一起在空闲时回收
+      AsynchLooper(const std::function<void(Buffer &)> &cb
+        , const LooperOptions &options = LooperOptions()
+        , const std::function<void()> &flush_cb = std::function<void()>()
+        , std::shared_ptr<ChunkPool> pool = nullptr)
+        : _stop(false)
+        , _pending(0)
+        , _options(options)
+        , _pool(pool ? pool : std::make_shared<ChunkPool>())
+        , _produce_buffer(_pool)
+        , _consumer_buffer(_pool)
         , _callBack(cb)
+        , _flushCallBack(flush_cb)
         , _thread(std::thread(&AsynchLooper::threadEntry, this))//传入 this 指针，以便在线程中访问成员
-    {}
+    {
+        _fork_slot = ForkHandler::registerHandler(&AsynchLooper::prepareFork, &AsynchLooper::parentAfterFork
+            , &AsynchLooper::childAfterFork, this);
+    }
       ~AsynchLooper(){
-        _stop = true;                    // 退出标志设置为true 
+        ForkHandler::unregisterHandler(_fork_slot);
+        {
+            // 加锁设置退出标志，避免消费者检查完条件、尚未挂起时错过通知
+            std::unique_lock<std::mutex> lock(_mutex);
+            _stop = true;                // 退出标志设置为true
+        }
         _consumer_cond.notify_all();     // 唤醒所有工作线程
         _thread.join();                  // 等待工作线程退出
       }
-      //生产
-      void push(const char *data, size_t len) {
+      //生产：写入一条等级为 level 的日志记录，记录头带上日志器编号和写入时间
+      void push(const char *data, size_t len, LogLevel::value level = LogLevel::DEBUG, uint32_t logger_id = 0) {
+        uint64_t ts_ns = Buffer::nowNs();   // 在锁外取时间
         std::unique_lock<std::mutex> lock(_mutex);
-        //缓冲区满了就阻塞
-        _produce_cond.wait(lock, [&](){ return _produce_buffer.writeAbleSize() >= len; });
+        waitForSpace(lock, len);
+        size_t before = _produce_buffer.readAbleSize();
         //向缓冲区添加数据
-        _produce_buffer.push(data, len);
-        //唤醒消费者对缓冲区中的数据进行处理
-        _consumer_cond.notify_one();   
+        _produce_buffer.push(data, len, level, logger_id, ts_ns);
+        notifyConsumer(before);
+      }
+      // 生产：一次加锁写入一整批中等级 >= min_level 的记录（保留原有的记录头）；需要过滤或比缓冲区还大的批次逐条写入
+      void push(Buffer &batch, LogLevel::value min_level = LogLevel::DEBUG) {
+        size_t len = batch.readAbleSize();
+        if (len == 0) return;
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (min_level > batch.minLevel() || len > _produce_buffer.readAbleSize() + _produce_buffer.writeAbleSize()) {
+            for (const RecordView &rec : batch.records()) {
+                if (rec.level < min_level) continue;
+                waitForSpace(lock, rec.len);
+                size_t before = _produce_buffer.readAbleSize();
+                _produce_buffer.push(rec.data, rec.len, rec.level, rec.logger_id, rec.ts_ns);
+                notifyConsumer(before);
+            }
+            return;
+        }
+        waitForSpace(lock, len);
+        size_t before = _produce_buffer.readAbleSize();
+        _produce_buffer.append(batch);
+        notifyConsumer(before);
+      }
+      /* 非阻塞生产（供协程使用）：放得下时写入并返回 true；放不下时不阻塞，把记录登记到等待队列并返回 false，
+         工作线程交换缓冲区后按登记顺序把它写进新的生产缓冲区，再调用一次 wake（在工作线程中、不持有锁）。
+         返回 false 时 data 必须保持有效直到 wake 被调用 */
+      bool tryPush(const char *data, size_t len, LogLevel::value level, uint32_t logger_id, std::function<void()> wake) {
+        uint64_t ts_ns = Buffer::nowNs();
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_space_waiters.empty() && hasSpace(len)) {
+            size_t before = _produce_buffer.readAbleSize();
+            _produce_buffer.push(data, len, level, logger_id, ts_ns);
+            notifyConsumer(before);
+            return true;
+        }
+        // 排在已有的等待者后面，保证先挂起的协程先写入
+        _space_waiters.push_back(SpaceWaiter{data, len, level, logger_id, ts_ns, std::move(wake)});
+        _stats.producer_waits.fetch_add(1, std::memory_order_relaxed);
+        _consumer_cond.notify_one();
+        return false;
+      }
+      // 等待调用之前 push 的数据全部经过回调并刷新落地，超时返回 false
+      bool flush(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        uint64_t ticket = ++_flush_requested;
+        _poke.store(true, std::memory_order_release);
+        _consumer_cond.notify_one();
+        return _flush_cond.wait_for(lock, timeout, [&](){ return _flush_done >= ticket; });
+      }
+      /* 非阻塞 flush（供协程使用）：发起一次 flush 请求后立即返回 false，
+         此前 push 的数据经过回调并刷新落地后，在工作线程中调用一次 wake */
+      bool tryFlush(std::function<void()> wake) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        uint64_t ticket = ++_flush_requested;
+        _flush_waiters.push_back(FlushWaiter{ticket, std::move(wake)});
+        _poke.store(true, std::memory_order_release);
+        _consumer_cond.notify_one();
+        return false;
+      }
+      // 统计信息
+      const LooperStats &stats() const { return _stats; }
+      // 当前占用的内存：块（使用中 + 池中缓存）+ 两个缓冲区的记录索引
+      size_t memoryFootprint() const {
+        return _pool->allocatedBytes() + _stats.index_bytes.load(std::memory_order_relaxed);
+      }
+      // 崩溃时把生产缓冲区中尚未处理的数据交给 write 写出（信号处理函数中调用，不加锁、不分配内存）
+      // 消费缓冲区正在被回调写出，不再重复输出
+      template<class F>
+      void emergencyDrain(F &&write) {
+        _produce_buffer.forEachChunk(write);
       }
       //消费
       void threadEntry() {
+        applyThreadOptions();
+        uint64_t flush_ticket = 0;
+        std::vector<std::function<void()>> wakes;   // 本轮要唤醒的协程，解锁后调用
         while (1) {
+            // 0、 挂起前先自旋一小会儿，数据很快到来时可以省掉一次 futex 睡眠/唤醒
+            spinWait();
             //互斥锁设置生命周期，交换完后解锁，不对数据过程加锁
             {
                 // 1、 判断生产缓冲区有没有数据，有则交换，无则阻塞
                 std::unique_lock<std::mutex> lock(_mutex);
+                _poke.store(false, std::memory_order_relaxed);
                 //lambda返回true，wait结束等待，返回false，释放锁并阻塞等待直到被唤醒再次判断lambda返回值
-                _consumer_cond.wait(lock, [&](){ return ( _stop || !_produce_buffer.bufferEmpty()); });
+                auto ready = [&](){ return ( _stop || _paused || flushPending() || !_produce_buffer.bufferEmpty()); };
+                // 突发过后空闲超过 idle_trim_ms 就回收一次内存，然后继续无限期等待
+                if (_options.idle_trim_ms > 0 && !_trimmed
+                    && !_consumer_cond.wait_for(lock, std::chrono::milliseconds(_options.idle_trim_ms), ready)) {
+                    trimIdle();
+                }
+                _consumer_cond.wait(lock, ready);
+                if (_paused) park(lock);
+                _trimmed = false;
+                // 数据还不够一批时，限时等待攒批，保证延迟有上界（有 flush 请求时不再等待）
+                // 忙轮询时攒批已经在 spinWait 中完成
+                if (!_options.busy_poll && !_stop && !flushPending() && !producersWaiting()
+                    && _produce_buffer.readAbleSize() < _options.batch_bytes) {
+                    _consumer_cond.wait_for(lock, std::chrono::microseconds(_options.max_wait_us), [&](){
+                        return _stop || flushPending() || producersWaiting() || _produce_buffer.readAbleSize() >= _options.batch_bytes;
+                    });
+                }
                 //再次检查,防止有数据了，!_produce_buffer.bufferEmpty() 为真，或者要退出了，_stop 为真
                 if (_stop && _produce_buffer.bufferEmpty()) {
                     break;
                 }
+                // 交换前记录 flush 请求编号：在此之前 push 的数据都在这次交换出去的缓冲区里
+                flush_ticket = _flush_requested;
+                recordSwap();
                 _produce_buffer.bufferSwap(_consumer_buffer);
-                // 2、 唤醒生产者(只有安全状态生产者才会被阻塞)
+                _pending.store(0, std::memory_order_relaxed);
+                // 2、 先把挂起的协程登记的记录写进新的生产缓冲区，再唤醒生产者(只有安全状态生产者才会被阻塞)
+                admitSpaceWaiters(wakes);
                 _produce_cond.notify_all();
             }
+            for (auto &wake : wakes) wake();
+            wakes.clear();
             // 3、 被唤醒后，对消费缓冲区进行数据处理(处理过程无需加锁保护)
-            _callBack(_consumer_buffer);
+            if (!_consumer_buffer.bufferEmpty()) {
+                _callBack(_consumer_buffer);
+            }
             // 4、 初始化消费缓冲区
             _consumer_buffer.bufferReset();
+            // 5、 有 flush 请求时刷新落地，并通知等待者
+            if (flush_ticket > _flush_done) {
+                if (_flushCallBack) _flushCallBack();
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _flush_done = flush_ticket;
+                    _flush_cond.notify_all();
+                    takeFlushWaiters(wakes);
+                }
+                for (auto &wake : wakes) wake();
+                wakes.clear();
+            }
+        }
+        // 退出前最后刷新一次，保证析构返回时数据已经交给落地方向
+        if (_flushCallBack) _flushCallBack();
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _flush_done = _flush_requested;
+            _flush_cond.notify_all();
+            takeFlushWaiters(wakes);
+        }
+        for (auto &wake : wakes) wake();
+      }
+
+    private:
+      /* 缓冲区满了就阻塞，阻塞前叫醒可能还在攒批的消费者（调用者持有 _mutex）。
+         缓冲区为空时总是放行：比整个容量还大的记录也能写入（单独占一个超大块），不会永远等下去 */
+      bool hasSpace(size_t len) { return _produce_buffer.writeAbleSize() >= len || _produce_buffer.bufferEmpty(); }
+      void waitForSpace(std::unique_lock<std::mutex> &lock, size_t len) {
+        if (hasSpace(len)) return;
+        _blocked_producers += 1;
+        _consumer_cond.notify_one();
+        uint64_t begin = StatsClock::nowNs();
+        _produce_cond.wait(lock, [&](){ return hasSpace(len); });
+        _stats.producer_waits.fetch_add(1, std::memory_order_relaxed);
+        _stats.producer_wait_ns.record(StatsClock::nowNs() - begin);
+        _blocked_producers -= 1;
+      }
+      // 进程要 fork：停在这里直到父进程 fork 完成（此时没有正在处理的批次，调用者持有 _mutex）
+      void park(std::unique_lock<std::mutex> &lock) {
+        _parked = true;
+        _idle_cond.notify_all();
+        _consumer_cond.wait(lock, [&](){ return !_paused; });
+        _parked = false;
+      }
+      // fork 前：等消费者停下，持有 _mutex 直到 fork 返回，生产者此时也停在锁上
+      static void prepareFork(void *arg) {
+        AsynchLooper *self = static_cast<AsynchLooper *>(arg);
+        std::unique_lock<std::mutex> lock(self->_mutex);
+        self->_paused = true;
+        self->_poke.store(true, std::memory_order_release);
+        self->_consumer_cond.notify_all();
+        self->_idle_cond.wait(lock, [self](){ return self->_parked; });
+        lock.release();
+      }
+      static void parentAfterFork(void *arg) {
+        AsynchLooper *self = static_cast<AsynchLooper *>(arg);
+        self->_paused = false;
+        self->_mutex.unlock();
+        self->_consumer_cond.notify_all();
+      }
+      /* 子进程：工作线程不存在，等待中的生产者和协程也不存在。缓冲区中的数据由父进程写出，这里丢弃；
+         条件变量上可能还记着父进程中的等待者，原地重新构造；原来的 std::thread 对象指向父进程的线程，
+         不能 join 也不能析构，直接在原处构造新的工作线程 */
+      static void childAfterFork(void *arg) {
+        AsynchLooper *self = static_cast<AsynchLooper *>(arg);
+        new (&self->_produce_cond) std::condition_variable();
+        new (&self->_consumer_cond) std::condition_variable();
+        new (&self->_flush_cond) std::condition_variable();
+        new (&self->_idle_cond) std::condition_variable();
+        self->_produce_buffer.bufferReset();
+        self->_consumer_buffer.bufferReset();
+        self->_pending.store(0, std::memory_order_relaxed);
+        self->_poke.store(false, std::memory_order_relaxed);
+        self->_blocked_producers = 0;
+        self->_space_waiters.clear();
+        self->_flush_waiters.clear();
+        self->_flush_done = self->_flush_requested;
+        self->_paused = false;
+        self->_parked = false;
+        self->_mutex.unlock();
+        new (&self->_thread) std::thread(&AsynchLooper::threadEntry, self);
+      }
+      // 有生产者（线程或协程）在等空间时，消费者不再攒批
+      bool producersWaiting() const { return _blocked_producers > 0 || !_space_waiters.empty(); }
+      // 交换后按登记顺序写入等待中的协程记录，放不下的留到下一轮（调用者持有 _mutex）
+      void admitSpaceWaiters(std::vector<std::function<void()>> &wakes) {
+        size_t admitted = 0;
+        for (; admitted < _space_waiters.size(); ++admitted) {
+            SpaceWaiter &w = _space_waiters[admitted];
+            if (!hasSpace(w.len)) break;
+            size_t before = _produce_buffer.readAbleSize();
+            _produce_buffer.push(w.data, w.len, w.level, w.logger_id, w.ts_ns);
+            notifyConsumer(before);
+            wakes.push_back(std::move(w.wake));
+        }
+        _space_waiters.erase(_space_waiters.begin(), _space_waiters.begin() + admitted);
+      }
+      // 取出已完成的 flush 等待者（调用者持有 _mutex）
+      void takeFlushWaiters(std::vector<std::function<void()>> &wakes) {
+        size_t kept = 0;
+        for (FlushWaiter &w : _flush_waiters) {
+            if (w.ticket <= _flush_done) wakes.push_back(std::move(w.wake));
+            else _flush_waiters[kept++] = std::move(w);
+        }
+        _flush_waiters.resize(kept);
+      }
+      //写入后更新 _pending，只在 空->非空 或者 刚好攒够一批 时唤醒消费者，其余情况消费者要么醒着，要么在等超时
+      void notifyConsumer(size_t before) {
+        size_t after = _produce_buffer.readAbleSize();
+        _pending.store(after, std::memory_order_release);
+        if (before == 0 || (before < _options.batch_bytes && after >= _options.batch_bytes)) {
+            _consumer_cond.notify_one();
+        }
+      }
+      // 空闲时回收：两个缓冲区都是空的，释放记录索引和池中缓存的块（消费者线程中调用，持有 _mutex）
+      void trimIdle() {
+        _produce_buffer.shrink();
+        _consumer_buffer.shrink();
+        _pool->trim();
+        _stats.idle_trims.fetch_add(1, std::memory_order_relaxed);
+        _stats.index_bytes.store(_produce_buffer.indexBytes() + _consumer_buffer.indexBytes(), std::memory_order_relaxed);
+        _trimmed = true;
+      }
+      // 交换前记录批大小和缓冲区占用（调用者持有 _mutex）
+      void recordSwap() {
+        size_t used = _produce_buffer.readAbleSize();
+        if (used == 0) return;
+        _stats.buffer_swaps.fetch_add(1, std::memory_order_relaxed);
+        _stats.batch_bytes.record(used);
+        _stats.batch_records.record(_produce_buffer.recordCount());
+        _stats.capacity.store(used + _produce_buffer.writeAbleSize(), std::memory_order_relaxed);
+        // 消费者线程中调用，此时消费缓冲区已处理完，可以安全读取
+        _stats.index_bytes.store(_produce_buffer.indexBytes() + _consumer_buffer.indexBytes(), std::memory_order_relaxed);
+        if (used > _stats.high_water.load(std::memory_order_relaxed))
+            _stats.high_water.store(used, std::memory_order_relaxed);
+      }
+      // 是否有尚未完成的 flush 请求（调用者需持有 _mutex）
+      bool flushPending() { return _flush_requested > _flush_done; }
+      // 自旋等待生产缓冲区攒够数据（不加锁，只读 _pending）
+      void spinWait() {
+        size_t want = _options.batch_bytes > 0 ? _options.batch_bytes : 1;
+        if (_options.busy_poll) {
+            // 一直自旋到攒够一批、第一条数据到达后超过 max_wait_us、有 flush 请求或者要退出
+            uint64_t first = 0;
+            while (!_stop && !_poke.load(std::memory_order_acquire)) {
+                size_t pending = _pending.load(std::memory_order_acquire);
+                if (pending >= want) return;
+                if (pending > 0) {
+                    uint64_t now = StatsClock::nowNs();
+                    if (first == 0) first = now;
+                    else if (now - first >= _options.max_wait_us * 1000) return;
+                }
+                cpuRelax();
+            }
+            return;
+        }
+        for (size_t i = 0; i < _options.spin_count; ++i) {
+            if (_stop || _pending.load(std::memory_order_acquire) >= want) return;
+            cpuRelax();
         }
-      }  
+      }
+      // 在消费线程开始时设置线程属性；失败只打印原因，不影响日志功能
+      void applyThreadOptions() {
+        if (!_options.thread_name.empty()) {
+            std::string name = _options.thread_name.substr(0, 15);   // 内核限制 16 字节（含结尾的 0）
+            pthread_setname_np(pthread_self(), name.c_str());
+        }
+        if (!_options.cpu_affinity.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu : _options.cpu_affinity)
+                if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+            int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            if (err != 0) std::cerr << "消费线程绑定 CPU 失败: " << strerror(err) << std::endl;
+        }
+        if (_options.sched_policy != SCHED_OTHER) {
+            sched_param param;
+            param.sched_priority = _options.sched_priority;
+            int err = pthread_setschedparam(pthread_self(), _options.sched_policy, &param);
+            if (err != 0) std::cerr << "消费线程设置调度策略失败: " << strerror(err) << std::endl;
+        }
+        // Linux 上 nice 值是线程级的，按线程号设置
+        if (_options.nice != 0 && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), _options.nice) != 0)
+            std::cerr << "消费线程设置 nice 失败: " << strerror(errno) << std::endl;
+      }
+      static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#else
+        std::this_thread::yield();
+#endif
+      }
 
     private:
+      // 因缓冲区满而挂起的协程登记的记录
+      struct SpaceWaiter {
+        const char *data;
+        size_t len;
+        LogLevel::value level;
+        uint32_t logger_id;
+        uint64_t ts_ns;
+        std::function<void()> wake;
+      };
+      // 等待 flush 完成的协程
+      struct FlushWaiter {
+        uint64_t ticket;
+        std::function<void()> wake;
+      };
       //工作流程，主线程写到生产缓冲区（要加锁），工作线程空闲时，交换两个缓冲区，工作线程读（不用加锁）
       std::atomic<bool> _stop;                  // 工作器停止标志，不加锁情况下可以被多个线程访问
-      std::mutex _mutex;          
+      std::atomic<size_t> _pending;             // 生产缓冲区中的字节数，供消费者自旋时无锁读取
+      std::atomic<bool> _poke{false};           // 有 flush 请求，让忙轮询的消费者停止自旋
+      LooperOptions _options;                   // 唤醒策略
+      std::mutex _mutex;
+      size_t _blocked_producers = 0;            // 因缓冲区满而阻塞的生产者数量（受 _mutex 保护）
+      bool _trimmed = false;                    // 自上次处理数据以来是否已经回收过（只在消费者线程中使用）
+      bool _paused = false;                     // 进程正在 fork，消费者停在 park()（受 _mutex 保护）
+      bool _parked = false;                     // 消费者已经停下（受 _mutex 保护）
+      int _fork_slot = -1;                      // fork 回调编号
+      LooperStats _stats;                       // 统计信息
+      std::shared_ptr<ChunkPool> _pool;         // 两个缓冲区共用的块池，消费完还回去的块给生产者复用
       Buffer _produce_buffer;                   // 生产缓冲区
       Buffer _consumer_buffer;                  // 消费缓冲区
       std::condition_variable _produce_cond;    // 生产条件变量，生产缓冲区满时，阻塞主线程
       std::condition_variable _consumer_cond;   // 消费条件变量，消费缓冲区空时，阻塞工作线程
-      std::thread _thread;        
+      std::condition_variable _flush_cond;      // flush 完成条件变量
+      std::condition_variable _idle_cond;       // fork 前等待消费者停下
+      uint64_t _flush_requested = 0;            // 已发起的 flush 请求编号（受 _mutex 保护）
+      uint64_t _flush_done = 0;                 // 已完成的 flush 请求编号（受 _mutex 保护）
+      std::vector<SpaceWaiter> _space_waiters;  // 等待空间的协程记录，按登记顺序（受 _mutex 保护）
+      std::vector<FlushWaiter> _flush_waiters;  // 等待 flush 完成的协程（受 _mutex 保护）
       std::function<void(Buffer &)> _callBack;  //回调函数 具体对缓冲区数据进行处理的回调函数， 由异步工作器的使用者传入
+      std::function<void()> _flushCallBack;     // 刷新落地方向的回调，可为空
+      std::thread _thread;                      // 工作线程，必须最后构造，保证线程启动时其他成员都已初始化
   };
 }
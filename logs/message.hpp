@@ -4,35 +4,182 @@
 
 #include "level.hpp"
 #include "util.hpp"
+#include "field.hpp"
+#include "fork.hpp"
 #include <ctime>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <cstring>
+#include <charconv>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 namespace MySpace {
+    /* 线程标识：每个线程第一次记录日志时取一次内核线程号（gettid，与 perf / top -H 中看到的一致），
+       并预先转成字符串缓存在线程局部存储中，之后每条日志只是拷贝。
+       fork 后子进程中只剩调用 fork 的线程，它的线程号变了：由 fork 的 child 回调在这个线程中重新取一次 */
+    class ThreadInfo {
+        public:
+            static const ThreadInfo &current() { return local(); }
+            // 给当前线程起名字（用于 %N 和结构化输出），同时设置内核线程名（最多 15 个字符）
+            static void setName(const std::string &name) {
+                local()._name = name;
+                pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+            }
+            uint32_t tid() const { return _tid; }
+            const char *tidText() const { return _text; }
+            size_t tidTextLen() const { return _text_len; }
+            const std::string &name() const { return _name; }
+        private:
+            ThreadInfo() {
+                static int fork_id = ForkHandler::registerHandler(&ThreadInfo::noop, &ThreadInfo::noop, &ThreadInfo::forkChild, nullptr);
+                (void)fork_id;
+                refresh();
+            }
+            void refresh() {
+                _tid = (uint32_t)::syscall(SYS_gettid);
+                auto r = std::to_chars(_text, _text + sizeof(_text) - 1, _tid);
+                *r.ptr = '\0';
+                _text_len = r.ptr - _text;
+            }
+            static void noop(void *) {}
+            // 子进程中只有调用 fork 的线程，它在这里运行
+            static void forkChild(void *) { local().refresh(); }
+            static ThreadInfo &local() {
+                static thread_local ThreadInfo info;
+                return info;
+            }
+        private:
+            uint32_t _tid;          // 内核线程号
+            char _text[12];         // 线程号的十进制文本
+            size_t _text_len;
+            std::string _name;      // 线程名，未设置时为空
+    };
+
     class LogMsg {
         public:
         time_t _ctime;                   // 日志产生的时间戳
         LogLevel::value _level;          // 日志等级
         std::string _file;               // 源文件名称
         size_t _line;                    // 源文件行号
-        std::thread::id _tid;            // 线程ID
+        uint32_t _tid;                   // 线程ID（内核线程号）
+        std::string _thread_name;        // 线程名，未设置时为空
         std::string _payload;            // 有效载荷，日志主体消息
         std::string _logger;             // 日志器
+        uint32_t _sample_rate;           // 采样率：该条日志代表 1/_sample_rate 的抽样，未采样时为 1
+        LogFields _fields;               // 结构化键值字段
 
         LogMsg(LogLevel::value level
             , size_t line
             , const std::string file
             , const std::string logger
             , const std::string msg) 
-            : _level(level)
-            , _ctime(util::getCurTime())
-            , _line(line)
+            : _ctime(util::getCurTime())
+            , _level(level)
             , _file(file)
-            , _logger(logger)
+            , _line(line)
+            , _tid(ThreadInfo::current().tid())
+            , _thread_name(ThreadInfo::current().name())
             , _payload(msg)
-            , _tid(std::this_thread::get_id()) 
+            , _logger(logger)
+            , _sample_rate(1)
         {}
+
+        /* 二进制编码：异步日志器使用结构化格式时，生产者只把消息按原始类型拷进缓冲区，
+           由工作线程解码后再格式化，字段值的文本化和转义都不在调用线程中进行 */
+        void encode(std::string &out) const {
+            out.clear();
+            putRaw(out, _ctime);
+            putRaw(out, _level);
+            putRaw(out, _line);
+            putRaw(out, _tid);
+            putRaw(out, _sample_rate);
+            putStr(out, _file);
+            putStr(out, _logger);
+            putStr(out, _payload);
+            putStr(out, _thread_name);
+            putRaw(out, (uint32_t)_fields.size());
+            for (auto &field : _fields) {
+                putRaw(out, field._type);
+                putStr(out, field._key);
+                if (field._type == LogField::STRING) putStr(out, field._str);
+                else putRaw(out, field._value);
+            }
+        }
+        // 解码 encode() 的结果，数据不完整时返回 false
+        bool decode(const char *data, size_t len) {
+            const char *end = data + len;
+            uint32_t count = 0;
+            if (!getRaw(data, end, _ctime) || !getRaw(data, end, _level) || !getRaw(data, end, _line)
+                || !getRaw(data, end, _tid) || !getRaw(data, end, _sample_rate)
+                || !getStr(data, end, _file) || !getStr(data, end, _logger) || !getStr(data, end, _payload)
+                || !getStr(data, end, _thread_name)
+                || !getRaw(data, end, count))
+                return false;
+            _fields.clear();
+            for (uint32_t i = 0; i < count; ++i) {
+                LogField field("", false);
+                if (!getRaw(data, end, field._type) || !getStr(data, end, field._key)) return false;
+                if (field._type == LogField::STRING) {
+                    if (!getStr(data, end, field._str)) return false;
+                } else if (!getRaw(data, end, field._value)) {
+                    return false;
+                }
+                _fields.push_back(std::move(field));
+            }
+            return true;
+        }
+        // encode() 结果中的基本信息，字符串指向编码数据内部
+        struct View {
+            time_t ctime;
+            LogLevel::value level;
+            size_t line;
+            uint32_t tid;
+            std::string_view file;
+            std::string_view logger;
+            std::string_view payload;
+        };
+        // 不分配内存地取出基本信息（信号处理函数中使用），数据不完整时返回 false
+        static bool peek(const char *data, size_t len, View &view) {
+            const char *end = data + len;
+            uint32_t sample_rate = 0;
+            return getRaw(data, end, view.ctime) && getRaw(data, end, view.level) && getRaw(data, end, view.line)
+                && getRaw(data, end, view.tid) && getRaw(data, end, sample_rate)
+                && getView(data, end, view.file) && getView(data, end, view.logger) && getView(data, end, view.payload);
+        }
+    private:
+        template<class T>
+        static void putRaw(std::string &out, const T &value) {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+        static void putStr(std::string &out, const std::string &str) {
+            putRaw(out, (uint32_t)str.size());
+            out.append(str);
+        }
+        template<class T>
+        static bool getRaw(const char *&data, const char *end, T &value) {
+            if ((size_t)(end - data) < sizeof(T)) return false;
+            memcpy(&value, data, sizeof(T));
+            data += sizeof(T);
+            return true;
+        }
+        static bool getStr(const char *&data, const char *end, std::string &str) {
+            uint32_t len = 0;
+            if (!getRaw(data, end, len) || (size_t)(end - data) < len) return false;
+            str.assign(data, len);
+            data += len;
+            return true;
+        }
+        static bool getView(const char *&data, const char *end, std::string_view &view) {
+            uint32_t len = 0;
+            if (!getRaw(data, end, len) || (size_t)(end - data) < len) return false;
+            view = std::string_view(data, len);
+            data += len;
+            return true;
+        }
     };
 }
 
@@ -4,11 +4,11 @@
 
 namespace MySpace{
     // 1、提供获取指定日志器的全局接口（避免用户自己操作单例对象）
-    std::shared_ptr<Logger> getLogger(const std::string& name) {
+    inline std::shared_ptr<Logger> getLogger(const std::string& name) {
         return LoggerManager::getInstance().getLogger(name);
     }
 
-    std::shared_ptr<Logger> rootLogger() {
+    inline std::shared_ptr<Logger> rootLogger() {
         return LoggerManager::getInstance().rootLogger();
     }
 
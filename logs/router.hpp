@@ -0,0 +1,479 @@
+//router.hpp
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include "level.hpp"
+#include "sink.hpp"
+#include "looper.hpp"
+#include "crash.hpp"
+#include "fork.hpp"
+
+#define DEFAULT_REORDER_WINDOW_MS 50//重排窗口默认 50ms
+#define DEFAULT_REORDER_PENDING (16 * 1024 * 1024)//重排窗口内最多积压 16M，超过就不再等待
+
+/*
+    共享落地方向与路由表：
+    1. SinkRegistry 按名字登记落地方向，同一个目的地（例如同一个文件）只创建一个实例，
+       由 SharedSink 包装成"单写者"：各日志器交来的批次先合并进它自己的双缓冲区，再由唯一的工作线程写出，
+       不会再出现多个 ofstream 同时追加同一个文件的竞争。
+    2. RouteTable 把 "日志器名称模式 + 最低等级" 映射到已登记的落地方向，
+       在创建日志器时解析一次，之后每条日志不再查表。
+    3. OrderedSink 在 SharedSink 的基础上按记录头中的纳秒时间戳重排，多个异步日志器写同一个目的地时输出按事件时间有序。
+*/
+namespace MySpace{
+    // 单写者的共享落地方向：多个日志器并发调用 log() 只是追加到缓冲区，由内部工作线程合并写出
+    class SharedSink : public LogSink {
+        public:
+            SharedSink(std::shared_ptr<LogSink> target, const LooperOptions &options = LooperOptions())
+                : _target(target)
+                , _looper(std::make_unique<AsynchLooper>(
+                    [this](Buffer &buf) { consume(buf); }
+                    , threadOptions(*target, options)
+                    , [this]() { _target->flush(); }))
+            {
+                _crash_slot = CrashHandler::registerDrain(&SharedSink::crashDrain, this);
+            }
+            ~SharedSink() {
+                CrashHandler::unregisterDrain(_crash_slot);
+                _looper.reset();     // 先停掉工作线程，把剩余数据写完
+            }
+            void log(const char *data, size_t len) override {
+                _looper->push(data, len);
+            }
+            void logRecord(LogLevel::value level, const char *data, size_t len) override {
+                _looper->push(data, len, level);
+            }
+            // 整批并入合并缓冲区，保留每条记录的头
+            void logRecords(Buffer &buf, LogLevel::value min_level) override {
+                _looper->push(buf, min_level);
+            }
+            bool levelAware() const override { return _target->levelAware(); }
+            // 等待合并缓冲区中的数据写出并刷新目标
+            void flush() override {
+                _looper->flush(std::chrono::milliseconds(1000));
+            }
+            void signalSafeWrite(const char *data, size_t len) override {
+                _target->signalSafeWrite(data, len);
+            }
+            std::string name() const override { return "shared:" + _target->name(); }
+            // 只是追加到工作器的缓冲区
+            bool concurrentSafe() const override { return true; }
+            std::shared_ptr<LogSink> target() { return _target; }
+        private:
+            // 工作线程：合并后的一批记录交给目标
+            void consume(Buffer &buf) {
+                _target->writeBatch(buf);
+            }
+            // 未指定线程名时用 "shared:目标名"
+            static LooperOptions threadOptions(const LogSink &target, LooperOptions options) {
+                if (options.thread_name.empty()) options.thread_name = "shared:" + target.name();
+                return options;
+            }
+            static void crashDrain(void *arg) {
+                SharedSink *self = static_cast<SharedSink *>(arg);
+                self->_looper->emergencyDrain([self](const char *data, size_t len) {
+                    self->_target->signalSafeWrite(data, len);
+                });
+            }
+        private:
+            std::shared_ptr<LogSink> _target;
+            std::unique_ptr<AsynchLooper> _looper;
+            int _crash_slot = -1;
+    };
+
+    /* 按时间有序合并的落地方向：多个日志器（各自的工作线程按各自的节奏交来批次）写同一个目的地时，
+       记录先在重排窗口中停留 window_ms，按记录头的时间戳（相同时按到达顺序）排好后再整批写出，
+       所以输出是一条按事件时间有序的流。
+       每轮新到的记录整批留在原来的缓冲区里，只把 (时间戳, 到达序号) 放进最小堆，到期的从堆顶依次拷贝到输出批次，
+       所以每条记录只多一次拷贝和一次 O(log n) 的堆操作，停留在窗口中的记录不会每轮重新拷贝和排序；
+       一批记录全部写出后它的缓冲区才回收复用。输出延迟增加 window_ms；比窗口还晚到的记录（例如日志器的批次卡住超过窗口）
+       照常写出但不再保证顺序，计入 late()。积压超过 max_pending 字节时不再等待窗口，直接全部写出 */
+    class OrderedSink : public LogSink {
+        public:
+            OrderedSink(std::shared_ptr<LogSink> target
+                , size_t window_ms = DEFAULT_REORDER_WINDOW_MS
+                , size_t max_pending = DEFAULT_REORDER_PENDING)
+                : _target(target)
+                , _window_ns(window_ms * 1000000ull)
+                , _max_pending(max_pending)
+                , _pool(std::make_shared<ChunkPool>())
+                , _incoming(_pool)
+                , _out(_pool)
+            {
+                _crash_slot = CrashHandler::registerDrain(&OrderedSink::crashDrain, this);
+                _thread = std::thread(&OrderedSink::threadEntry, this);
+                _fork_slot = ForkHandler::registerHandler(&OrderedSink::prepareFork, &OrderedSink::parentAfterFork
+                    , &OrderedSink::childAfterFork, this);
+            }
+            ~OrderedSink() {
+                ForkHandler::unregisterHandler(_fork_slot);
+                CrashHandler::unregisterDrain(_crash_slot);
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _stop = true;
+                }
+                _cond.notify_all();
+                _thread.join();     // 退出前把窗口中剩下的记录全部写出
+            }
+            // 没有记录头的数据以到达时间作为时间戳
+            void log(const char *data, size_t len) override {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _incoming.push(data, len, LogLevel::DEBUG);
+            }
+            void logRecord(LogLevel::value level, const char *data, size_t len) override {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _incoming.push(data, len, level);
+            }
+            // 异步日志器交来的整批：保留记录头中的时间戳
+            void logRecords(Buffer &buf, LogLevel::value min_level) override {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _incoming.append(buf, min_level);
+            }
+            // 不等窗口，把已经收到的记录全部排序写出并刷新目标
+            void flush() override {
+                std::unique_lock<std::mutex> lock(_mutex);
+                uint64_t ticket = ++_flush_requested;
+                _cond.notify_all();
+                _flush_cond.wait_for(lock, std::chrono::milliseconds(1000), [&]() { return _flush_done >= ticket; });
+            }
+            void signalSafeWrite(const char *data, size_t len) override {
+                _target->signalSafeWrite(data, len);
+            }
+            std::string name() const override { return "ordered:" + _target->name(); }
+            bool concurrentSafe() const override { return true; }
+            std::shared_ptr<LogSink> target() { return _target; }
+            // 晚于重排窗口到达、没能排进顺序的记录数
+            uint64_t late() const { return _late.load(std::memory_order_relaxed); }
+        private:
+            // 窗口中的一轮记录：remaining 条还没写出，为 0 时缓冲区回收
+            struct Batch {
+                explicit Batch(std::shared_ptr<ChunkPool> pool) : buf(pool) {}
+                Buffer buf;
+                size_t remaining = 0;
+            };
+            // 堆中的记录：指向所在批次的缓冲区，sequence 是到达顺序，时间戳相同时保持原来的先后
+            struct Pending {
+                RecordView rec;
+                uint64_t sequence;
+                Batch *batch;
+            };
+            // 堆顶是最早的记录
+            static bool later(const Pending &a, const Pending &b) {
+                return a.rec.ts_ns != b.rec.ts_ns ? a.rec.ts_ns > b.rec.ts_ns : a.sequence > b.sequence;
+            }
+            void threadEntry() {
+                // 每 1/4 个窗口检查一次，记录最多比窗口晚 1/4 窗口写出
+                auto tick = std::chrono::nanoseconds(std::max<uint64_t>(_window_ns / 4, 1000000));
+                while (true) {
+                    uint64_t flush_ticket;
+                    bool stop;
+                    std::unique_ptr<Batch> batch = takeBatch();
+                    {
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        _cond.wait_for(lock, tick, [&]() { return _stop || _paused || _flush_requested > _flush_done; });
+                        // 进程要 fork：停在这里（上一轮已经写完，不持有目标的锁）直到父进程 fork 完成
+                        if (_paused) {
+                            _parked = true;
+                            _idle_cond.notify_all();
+                            _cond.wait(lock, [&]() { return !_paused; });
+                            _parked = false;
+                        }
+                        stop = _stop;
+                        flush_ticket = _flush_requested;
+                        _incoming.bufferSwap(batch->buf);
+                    }
+                    admit(std::move(batch));
+                    bool drain_all = stop || flush_ticket > _flush_done || _pending_bytes > _max_pending;
+                    emit(drain_all ? UINT64_MAX : Buffer::nowNs() - _window_ns);
+                    if (flush_ticket > _flush_done) {
+                        _target->flush();
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        _flush_done = flush_ticket;
+                        _flush_cond.notify_all();
+                    }
+                    if (stop) break;
+                }
+                _target->flush();
+            }
+            // 空的批次：优先复用已经写完的
+            std::unique_ptr<Batch> takeBatch() {
+                if (_free.empty()) return std::unique_ptr<Batch>(new Batch(_pool));
+                std::unique_ptr<Batch> batch = std::move(_free.back());
+                _free.pop_back();
+                return batch;
+            }
+            // 新到的一轮记录留在原地，只把下标放进堆
+            void admit(std::unique_ptr<Batch> batch) {
+                if (batch->buf.recordCount() == 0) {
+                    _free.push_back(std::move(batch));
+                    return;
+                }
+                for (const RecordView &rec : batch->buf.records()) {
+                    _heap.push_back(Pending{rec, _sequence++, batch.get()});
+                    std::push_heap(_heap.begin(), _heap.end(), &OrderedSink::later);
+                }
+                batch->remaining = batch->buf.recordCount();
+                _pending_bytes += batch->buf.readAbleSize();
+                _window.push_back(std::move(batch));
+            }
+            // 从堆顶依次写出时间戳 <= watermark 的记录，然后回收全部写出的批次
+            void emit(uint64_t watermark) {
+                while (!_heap.empty() && _heap.front().rec.ts_ns <= watermark) {
+                    std::pop_heap(_heap.begin(), _heap.end(), &OrderedSink::later);
+                    const Pending &p = _heap.back();
+                    const RecordView &rec = p.rec;
+                    if (rec.ts_ns < _last_ts) _late.fetch_add(1, std::memory_order_relaxed);
+                    else _last_ts = rec.ts_ns;
+                    _out.push(rec.data, rec.len, rec.level, rec.logger_id, rec.ts_ns);
+                    p.batch->remaining--;
+                    _heap.pop_back();
+                }
+                if (_out.bufferEmpty()) return;
+                _target->writeBatch(_out);
+                _out.bufferReset();
+                for (auto it = _window.begin(); it != _window.end();) {
+                    if ((*it)->remaining > 0) { ++it; continue; }
+                    _pending_bytes -= (*it)->buf.readAbleSize();
+                    (*it)->buf.bufferReset();
+                    _free.push_back(std::move(*it));
+                    it = _window.erase(it);
+                }
+            }
+            // 崩溃时来不及排序，窗口中的批次按原样写出（部分写出过的批次可能重复输出）
+            static void crashDrain(void *arg) {
+                OrderedSink *self = static_cast<OrderedSink *>(arg);
+                auto write = [self](const char *data, size_t len) { self->_target->signalSafeWrite(data, len); };
+                for (auto &batch : self->_window) batch->buf.forEachChunk(write);
+                self->_incoming.forEachChunk(write);
+            }
+            // fork 前等工作线程停下，持有 _mutex 直到 fork 返回（见 fork.hpp）
+            static void prepareFork(void *arg) {
+                OrderedSink *self = static_cast<OrderedSink *>(arg);
+                std::unique_lock<std::mutex> lock(self->_mutex);
+                self->_paused = true;
+                self->_cond.notify_all();
+                self->_idle_cond.wait(lock, [self]() { return self->_parked; });
+                lock.release();
+            }
+            static void parentAfterFork(void *arg) {
+                OrderedSink *self = static_cast<OrderedSink *>(arg);
+                self->_paused = false;
+                self->_mutex.unlock();
+                self->_cond.notify_all();
+            }
+            // 子进程：窗口中的记录由父进程写出，这里丢弃；重新构造条件变量并启动新的工作线程
+            static void childAfterFork(void *arg) {
+                OrderedSink *self = static_cast<OrderedSink *>(arg);
+                new (&self->_cond) std::condition_variable();
+                new (&self->_flush_cond) std::condition_variable();
+                new (&self->_idle_cond) std::condition_variable();
+                self->_incoming.bufferReset();
+                self->_heap.clear();
+                for (auto &batch : self->_window) {
+                    batch->buf.bufferReset();
+                    self->_free.push_back(std::move(batch));
+                }
+                self->_window.clear();
+                self->_pending_bytes = 0;
+                self->_flush_done = self->_flush_requested;
+                self->_paused = false;
+                self->_parked = false;
+                self->_mutex.unlock();
+                new (&self->_thread) std::thread(&OrderedSink::threadEntry, self);
+            }
+        private:
+            std::shared_ptr<LogSink> _target;
+            uint64_t _window_ns;                // 重排窗口
+            size_t _max_pending;                // 窗口中最多积压的字节数
+            std::shared_ptr<ChunkPool> _pool;
+            std::mutex _mutex;
+            std::condition_variable _cond;
+            std::condition_variable _flush_cond;
+            std::condition_variable _idle_cond; // fork 前等待工作线程停下
+            bool _paused = false;               // 以下五项受 _mutex 保护：进程正在 fork
+            bool _parked = false;               // 工作线程已经停下
+            bool _stop = false;
+            uint64_t _flush_requested = 0;
+            uint64_t _flush_done = 0;
+            Buffer _incoming;                   // 生产者写入（受 _mutex 保护）
+            std::deque<std::unique_ptr<Batch>> _window;     // 以下只在工作线程中使用：还有记录在窗口中的批次
+            std::vector<std::unique_ptr<Batch>> _free;      // 已经写完、可以复用的批次
+            std::vector<Pending> _heap;         // 窗口中的记录，按 later 排成最小堆
+            uint64_t _sequence = 0;             // 到达序号
+            size_t _pending_bytes = 0;          // _window 中批次的字节数
+            Buffer _out;                        // 本轮排好序要写出的记录
+            uint64_t _last_ts = 0;              // 已写出的最大时间戳
+            std::atomic<uint64_t> _late{0};
+            int _crash_slot = -1;
+            int _fork_slot = -1;
+            std::thread _thread;
+    };
+
+    // 路由结果：转发到共享落地方向，但带有该条路由自己的等级阈值
+    class RouteSink : public LogSink {
+        public:
+            RouteSink(std::shared_ptr<LogSink> target, LogLevel::value level)
+                : _target(target)
+            {
+                setLevel(level);
+            }
+            // 经过目标的 write*()，路由来的流量也计入目标自己的统计
+            void log(const char *data, size_t len) override { _target->write(data, len); }
+            void logRecord(LogLevel::value level, const char *data, size_t len) override { _target->writeRecord(level, data, len); }
+            void logRecords(Buffer &buf, LogLevel::value min_level) override { _target->writeBatch(buf, min_level); }
+            bool levelAware() const override { return _target->levelAware(); }
+            void flush() override { _target->flush(); }
+            void signalSafeWrite(const char *data, size_t len) override { _target->signalSafeWrite(data, len); }
+            std::string name() const override { return _target->name(); }
+            bool concurrentSafe() const override { return _target->concurrentSafe(); }
+        private:
+            std::shared_ptr<LogSink> _target;
+    };
+
+    // 落地方向注册表（单例）：名字 -> 共享落地方向
+    class SinkRegistry {
+        public:
+            static SinkRegistry &getInstance() {
+                static SinkRegistry registry;
+                return registry;
+            }
+            // 取已登记的落地方向，不存在时用 Args 创建 T 并包装成 SharedSink 登记
+            template<class T, class ...Args>
+            std::shared_ptr<LogSink> getOrCreate(const std::string &key, Args&&... args) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                auto it = _sinks.find(key);
+                if (it != _sinks.end()) return it->second;
+                auto sink = std::make_shared<SharedSink>(std::make_shared<T>(std::forward<Args>(args)...));
+                _sinks[key] = sink;
+                return sink;
+            }
+            // 登记一个已经创建好的落地方向（同名覆盖）
+            void add(const std::string &key, std::shared_ptr<LogSink> sink) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _sinks[key] = sink;
+            }
+            std::shared_ptr<LogSink> get(const std::string &key) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                auto it = _sinks.find(key);
+                return it == _sinks.end() ? nullptr : it->second;
+            }
+            // 常用目的地：以 "file:路径" / "stdout" 为名字
+            std::shared_ptr<LogSink> file(const std::string &pathname) {
+                return getOrCreate<FileSink>("file:" + pathname, pathname);
+            }
+            std::shared_ptr<LogSink> stdout_() {
+                return getOrCreate<StdoutSink>("stdout");
+            }
+            /* 依次刷新并放开所有登记的落地方向（LoggerManager::shutdown 在日志器之后调用）；
+               超过 deadline 的不再刷新，返回是否全部按时完成 */
+            bool clear(std::chrono::steady_clock::time_point deadline) {
+                std::unordered_map<std::string, std::shared_ptr<LogSink>> sinks;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    sinks.swap(_sinks);
+                }
+                bool ok = true;
+                for (auto &it : sinks) {
+                    if (ok && std::chrono::steady_clock::now() >= deadline) ok = false;
+                    if (ok) it.second->flush();
+                    // 来不及刷新的不再析构（析构要等工作线程把剩余数据写完），留给进程退出
+                    else leaked().push_back(it.second);
+                }
+                return ok;
+            }
+        private:
+            static std::vector<std::shared_ptr<LogSink>> &leaked() {
+                static auto *sinks = new std::vector<std::shared_ptr<LogSink>>();
+                return *sinks;
+            }
+            SinkRegistry() {}
+            SinkRegistry(const SinkRegistry &) = delete;
+            SinkRegistry &operator=(const SinkRegistry &) = delete;
+        private:
+            std::mutex _mutex;
+            std::unordered_map<std::string, std::shared_ptr<LogSink>> _sinks;
+    };
+
+    // 路由表（单例）：日志器名称模式（支持 * 和 ?）+ 最低等级 -> 落地方向名字
+    class RouteTable {
+        public:
+            struct Route {
+                std::string pattern;       // 日志器名称模式，例如 "db.*"
+                LogLevel::value level;     // 该路由接收的最低等级
+                std::string sink;          // SinkRegistry 中的名字
+            };
+            static RouteTable &getInstance() {
+                static RouteTable table;
+                return table;
+            }
+            void addRoute(const std::string &pattern, LogLevel::value level, const std::string &sink) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _routes.push_back(Route{pattern, level, sink});
+            }
+            void clear() {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _routes.clear();
+            }
+            // 解析出 logger_name 对应的落地方向列表（创建日志器时调用一次）
+            // 同一个落地方向被多条路由命中时只保留一个，等级取最低的那条
+            std::vector<std::shared_ptr<LogSink>> resolve(const std::string &logger_name) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                std::vector<std::pair<std::string, LogLevel::value>> hits;
+                for (auto &route : _routes) {
+                    if (!match(route.pattern, logger_name)) continue;
+                    bool merged = false;
+                    for (auto &hit : hits) {
+                        if (hit.first == route.sink) {
+                            hit.second = std::min(hit.second, route.level);
+                            merged = true;
+                        }
+                    }
+                    if (!merged) hits.emplace_back(route.sink, route.level);
+                }
+                std::vector<std::shared_ptr<LogSink>> sinks;
+                for (auto &hit : hits) {
+                    auto target = SinkRegistry::getInstance().get(hit.first);
+                    if (!target) {
+                        std::cerr << "路由目标不存在: " << hit.first << std::endl;
+                        continue;
+                    }
+                    sinks.push_back(std::make_shared<RouteSink>(target, hit.second));
+                }
+                return sinks;
+            }
+            // 通配符匹配：* 匹配任意串，? 匹配单个字符
+            static bool match(const std::string &pattern, const std::string &name) {
+                size_t p = 0, n = 0, star = std::string::npos, mark = 0;
+                while (n < name.size()) {
+                    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                        ++p; ++n;
+                    } else if (p < pattern.size() && pattern[p] == '*') {
+                        star = p++;
+                        mark = n;
+                    } else if (star != std::string::npos) {
+                        p = star + 1;
+                        n = ++mark;
+                    } else {
+                        return false;
+                    }
+                }
+                while (p < pattern.size() && pattern[p] == '*') ++p;
+                return p == pattern.size();
+            }
+        private:
+            RouteTable() {}
+            RouteTable(const RouteTable &) = delete;
+            RouteTable &operator=(const RouteTable &) = delete;
+        private:
+            std::mutex _mutex;
+            std::vector<Route> _routes;
+    };
+}
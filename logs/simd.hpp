@@ -0,0 +1,182 @@
+//simd.hpp
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LOG_SIMD_X86 1
+#else
+#define LOG_SIMD_X86 0
+#endif
+
+/*
+    扫描日志字节的向量化内核：查找记录边界（换行）、统计换行数、查找需要转义的字符。
+    x86 上按 CPU 在运行时选择 AVX2（一次 32 字节）或 SSE2（一次 16 字节），其他平台使用标量实现。
+    AVX2 版本用 target 属性单独编译，不需要给整个工程加 -mavx2。
+*/
+namespace MySpace{
+    class Simd {
+        public:
+            // 第一个等于 c 的位置，没有则返回 len
+            static size_t findByte(const char *s, size_t len, char c) {
+                return kernels().find_byte(s, len, c);
+            }
+            // 等于 c 的字节个数
+            static size_t countByte(const char *s, size_t len, char c) {
+                return kernels().count_byte(s, len, c);
+            }
+            /* 第一个需要转义的字符位置，没有则返回 len。
+               控制字符（< 0x20）、双引号、反斜杠；logfmt 为 true 时还包括空格和 = */
+            static size_t findEscape(const char *s, size_t len, bool logfmt) {
+                return kernels().find_escape(s, len, logfmt);
+            }
+            /* 把按换行拼接的一批日志拆成单条，对每条调用 fn(data, len)（不含换行符）；
+               末尾没有换行的部分也作为一条 */
+            template<class F>
+            static void forEachLine(const char *data, size_t len, F &&fn) {
+                size_t pos = 0;
+                while (pos < len) {
+                    size_t eol = pos + findByte(data + pos, len - pos, '\n');
+                    fn(data + pos, eol - pos);
+                    pos = eol + 1;
+                }
+            }
+            // 当前使用的实现："avx2" / "sse2" / "scalar"
+            static const char *isa() { return kernels().name; }
+        private:
+            struct Kernels {
+                const char *name;
+                size_t (*find_byte)(const char *, size_t, char);
+                size_t (*count_byte)(const char *, size_t, char);
+                size_t (*find_escape)(const char *, size_t, bool);
+            };
+            // 第一次使用时按 CPU 选择一次
+            static const Kernels &kernels() {
+                static const Kernels k = select();
+                return k;
+            }
+            static Kernels select() {
+#if LOG_SIMD_X86
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2"))
+                    return Kernels{"avx2", &findByteAvx2, &countByteAvx2, &findEscapeAvx2};
+#if defined(__SSE2__)
+                return Kernels{"sse2", &findByteSse2, &countByteSse2, &findEscapeSse2};
+#endif
+#endif
+                return Kernels{"scalar", &findByteScalar, &countByteScalar, &findEscapeScalar};
+            }
+
+            // ---------------- 标量实现（也用于处理向量循环剩下的尾部） ----------------
+            static size_t findByteScalar(const char *s, size_t len, char c) {
+                const void *p = memchr(s, c, len);
+                return p ? (size_t)((const char *)p - s) : len;
+            }
+            static size_t countByteScalar(const char *s, size_t len, char c) {
+                size_t n = 0;
+                for (size_t i = 0; i < len; ++i) n += s[i] == c;
+                return n;
+            }
+            static bool isEscape(unsigned char c, bool logfmt) {
+                return c < 0x20 || c == '"' || c == '\\' || (logfmt && (c == ' ' || c == '='));
+            }
+            static size_t findEscapeScalar(const char *s, size_t len, bool logfmt) {
+                for (size_t i = 0; i < len; ++i)
+                    if (isEscape((unsigned char)s[i], logfmt)) return i;
+                return len;
+            }
+
+#if LOG_SIMD_X86 && defined(__SSE2__)
+            // ---------------- SSE2：一次 16 字节 ----------------
+            static size_t findByteSse2(const char *s, size_t len, char c) {
+                const __m128i needle = _mm_set1_epi8(c);
+                size_t i = 0;
+                for (; i + 16 <= len; i += 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+                    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+                    if (mask) return i + __builtin_ctz(mask);
+                }
+                return i + findByteScalar(s + i, len - i, c);
+            }
+            static size_t countByteSse2(const char *s, size_t len, char c) {
+                const __m128i needle = _mm_set1_epi8(c);
+                size_t i = 0, n = 0;
+                for (; i + 16 <= len; i += 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+                    n += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)));
+                }
+                return n + countByteScalar(s + i, len - i, c);
+            }
+            static size_t findEscapeSse2(const char *s, size_t len, bool logfmt) {
+                const __m128i ctrl = _mm_set1_epi8(0x1F);
+                const __m128i quote = _mm_set1_epi8('"');
+                const __m128i slash = _mm_set1_epi8('\\');
+                const __m128i space = _mm_set1_epi8(' ');
+                const __m128i equal = _mm_set1_epi8('=');
+                size_t i = 0;
+                for (; i + 16 <= len; i += 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+                    // 无符号 v <= 0x1F 等价于 max(v, 0x1F) == 0x1F
+                    __m128i hit = _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl);
+                    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, quote));
+                    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, slash));
+                    if (logfmt) {
+                        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, space));
+                        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, equal));
+                    }
+                    int mask = _mm_movemask_epi8(hit);
+                    if (mask) return i + __builtin_ctz(mask);
+                }
+                return i + findEscapeScalar(s + i, len - i, logfmt);
+            }
+#endif
+
+#if LOG_SIMD_X86
+            // ---------------- AVX2：一次 32 字节 ----------------
+            __attribute__((target("avx2")))
+            static size_t findByteAvx2(const char *s, size_t len, char c) {
+                const __m256i needle = _mm256_set1_epi8(c);
+                size_t i = 0;
+                for (; i + 32 <= len; i += 32) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+                    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle));
+                    if (mask) return i + __builtin_ctz(mask);
+                }
+                return i + findByteScalar(s + i, len - i, c);
+            }
+            __attribute__((target("avx2,popcnt")))
+            static size_t countByteAvx2(const char *s, size_t len, char c) {
+                const __m256i needle = _mm256_set1_epi8(c);
+                size_t i = 0, n = 0;
+                for (; i + 32 <= len; i += 32) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+                    n += __builtin_popcount((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+                }
+                return n + countByteScalar(s + i, len - i, c);
+            }
+            __attribute__((target("avx2")))
+            static size_t findEscapeAvx2(const char *s, size_t len, bool logfmt) {
+                const __m256i ctrl = _mm256_set1_epi8(0x1F);
+                const __m256i quote = _mm256_set1_epi8('"');
+                const __m256i slash = _mm256_set1_epi8('\\');
+                const __m256i space = _mm256_set1_epi8(' ');
+                const __m256i equal = _mm256_set1_epi8('=');
+                size_t i = 0;
+                for (; i + 32 <= len; i += 32) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+                    __m256i hit = _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl), ctrl);
+                    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, quote));
+                    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, slash));
+                    if (logfmt) {
+                        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, space));
+                        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, equal));
+                    }
+                    unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+                    if (mask) return i + __builtin_ctz(mask);
+                }
+                return i + findEscapeScalar(s + i, len - i, logfmt);
+            }
+#endif
+    };
+}
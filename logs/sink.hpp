@@ -3,6 +3,8 @@
 #include "level.hpp"
 #include "util.hpp"
 #include "message.hpp"
+#include "format.hpp"
+#include "buffer.hpp"
 #include <string>
 #include <iostream>
 #include <assert.h>
@@ -10,74 +12,537 @@
 #include <memory>
 #include <sstream>
 #include <mutex>
-// MySQL Connector/C++ 头文件
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "crash.hpp"
+#include "fork.hpp"
+#include "stats.hpp"
+#include "simd.hpp"
+#include "index.hpp"
+#define DEFAULT_RECORDER_SIZE (4 * 1024 * 1024)//飞行记录器默认 4M
+#define RECORDER_SLOT_SIZE 256//飞行记录器每个槽位的大小（含 12 字节槽位头）
+#define DEFAULT_STDOUT_BUFFER (256 * 1024)//标准输出缓冲区默认 256K（每个线程的暂存区不超过 STDOUT_STAGE_SIZE）
+#define STDOUT_STAGE_SIZE (64 * 1024)//标准输出每个线程的暂存区上限 64K
+#define DEFAULT_STDOUT_FLUSH_MS 100//标准输出缓冲区默认最多 100ms 写出一次
+#define DEFAULT_NET_BLOCK_MS 20//网络落地方向每次调用最多阻塞 20ms
+#define DEFAULT_SPILL_SIZE (64 * 1024 * 1024)//网络落地方向暂存上限 64M
+#define MAX_UDP_DATAGRAM 65507//UDP 数据报负载上限（IPv4：65535 - IP 头 20 - UDP 头 8）
+
+// MySQL Connector/C++ 头文件（可选依赖：未安装时不提供 MySQLSink，也可以用 -DLOG_WITH_MYSQL=0 显式关闭）
+#ifndef LOG_WITH_MYSQL
+#if __has_include(<mysql_driver.h>)
+#define LOG_WITH_MYSQL 1
+#else
+#define LOG_WITH_MYSQL 0
+#endif
+#endif
+#if LOG_WITH_MYSQL
 #include <mysql_driver.h>
 #include <mysql_connection.h>
 #include <cppconn/statement.h>
 #include <cppconn/prepared_statement.h>
 #include <cppconn/exception.h>
+#endif
 
 namespace MySpace{
     class LogSink {
         public:
-            virtual void log(const std::string& data, size_t len) = 0;
+            LogSink() : _level(LogLevel::DEBUG) {}
+            virtual ~LogSink() {}
+            // 直接接收缓冲区中的字节，不再为每次调用构造临时 std::string
+            virtual void log(const char *data, size_t len) = 0;
+            // 本落地方向接收的最低等级，低于它的日志由日志器过滤掉，不会交给 log()
+            void setLevel(LogLevel::value level) { _level = level; }
+            LogLevel::value level() const { return _level; }
+            // 日志器统一通过 write() 调用 log()，顺带统计调用次数、字节数和耗时
+            void write(const char *data, size_t len) {
+                uint64_t begin = StatsClock::nowNs();
+                log(data, len);
+                _stats.latency_ns.record(StatsClock::nowNs() - begin);
+                _stats.bytes.fetch_add(len, std::memory_order_relaxed);
+            }
+            // 同 write()，但带上这条日志的等级（调用 logRecord()）
+            void writeRecord(LogLevel::value level, const char *data, size_t len) {
+                uint64_t begin = StatsClock::nowNs();
+                logRecord(level, data, len);
+                _stats.latency_ns.record(StatsClock::nowNs() - begin);
+                _stats.bytes.fetch_add(len, std::memory_order_relaxed);
+            }
+            // 交付异步缓冲区中的一整批记录（调用 logRecords()，只取等级达到本落地方向等级和 min_level 的记录）
+            // 字节数只计等级达标、实际交给落地方向的部分
+            void writeBatch(Buffer &buf, LogLevel::value min_level = LogLevel::DEBUG) {
+                min_level = std::max(min_level, level());
+                uint64_t begin = StatsClock::nowNs();
+                logRecords(buf, min_level);
+                _stats.latency_ns.record(StatsClock::nowNs() - begin);
+                _stats.bytes.fetch_add(buf.bytesOf(min_level), std::memory_order_relaxed);
+            }
+            // 需要知道每条日志等级的落地方向（例如按等级着色）返回 true
+            virtual bool levelAware() const { return false; }
+            // 接收单条日志及其等级，默认忽略等级
+            virtual void logRecord(LogLevel::value, const char *data, size_t len) { log(data, len); }
+            /* 接收一批记录中等级 >= min_level 的部分：默认不关心等级的落地方向把连续的正文零拷贝交给 log()，
+               关心等级的逐条调用 logRecord()。需要记录头（时间、日志器编号）或想自己分批的落地方向可以重写，
+               用 buf.records() 遍历；直接写描述符的可以用 buf.iovecs() 一次 writev */
+            virtual void logRecords(Buffer &buf, LogLevel::value min_level) {
+                if (!levelAware()) {
+                    buf.forEachRun(min_level, [this](const char *data, size_t len) { log(data, len); });
+                    return;
+                }
+                for (const RecordView &rec : buf.records())
+                    if (rec.level >= min_level) logRecord(rec.level, rec.data, rec.len);
+            }
+            // 落地方向名称，用于统计输出
+            virtual std::string name() const { return "sink"; }
+            SinkStatsSnapshot stats() const {
+                SinkStatsSnapshot s;
+                s.name = name();
+                s.bytes = _stats.bytes.load(std::memory_order_relaxed);
+                s.errors = _stats.errors.load(std::memory_order_relaxed);
+                s.latency_ns = _stats.latency_ns.snapshot();
+                s.writes = s.latency_ns.count;
+                return s;
+            }
+            // 把已经写出的数据刷到落地方向（默认无缓冲，什么也不做）
+            virtual void flush() {}
+            // 崩溃时由信号处理函数调用：只能使用异步信号安全的操作（write(2)），默认丢弃
+            virtual void signalSafeWrite(const char *, size_t) {}
+            /* 多个线程能否同时调用 log()：为 true 时同步日志器不再为它加全局锁。
+               自身加锁或每次调用只是一次原子追加的落地方向可以返回 true（默认 false） */
+            virtual bool concurrentSafe() const { return false; }
+        protected:
+            // 写入失败时由派生类调用，计入统计
+            void reportError() { _stats.errors.fetch_add(1, std::memory_order_relaxed); }
+        protected:
+            std::atomic<LogLevel::value> _level;   // 落地等级阈值
+            SinkStats _stats;                      // 落地统计
+    };
+    /* 标准输出类落地方向共用的定时写出线程：每个 StdoutSink 一个线程太浪费，所有实例在这里登记，
+       由一个线程按其中最短的间隔轮流检查。线程在第一次登记时启动，之后一直存在；
+       对象故意不析构，静态析构阶段仍可能有落地方向注销。 */
+    class StdoutFlusher {
+        public:
+            using TickFunc = void (*)(void *arg);
+
+            static StdoutFlusher &getInstance() {
+                static StdoutFlusher *flusher = new StdoutFlusher();
+                return *flusher;
+            }
+            // 登记：大约每 interval_ms 调用一次 tick(arg)
+            void add(TickFunc tick, void *arg, size_t interval_ms) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _entries.push_back(Entry{tick, arg, interval_ms});
+                if (!_started) {
+                    _started = true;
+                    std::thread(&StdoutFlusher::threadEntry, this).detach();
+                }
+                _cond.notify_all();     // 新的间隔可能更短
+            }
+            // 注销：返回后不会再调用它的 tick（正在调用时等它返回）
+            void remove(void *arg) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+                    if (it->arg == arg) {
+                        _entries.erase(it);
+                        break;
+                    }
+                }
+                _idle_cond.wait(lock, [&]() { return _current != arg; });
+            }
+        private:
+            struct Entry {
+                TickFunc tick;
+                void *arg;
+                size_t interval_ms;
+            };
+            StdoutFlusher() {
+                ForkHandler::registerHandler(&StdoutFlusher::prepareFork, &StdoutFlusher::parentAfterFork
+                    , &StdoutFlusher::childAfterFork, this);
+            }
+            // tick 在锁外调用：它要拿落地方向自己的锁，持有 _mutex 等待会和 fork 的 prepare 顺序相反
+            void threadEntry() {
+                std::unique_lock<std::mutex> lock(_mutex);
+                while (true) {
+                    if (_entries.empty()) {
+                        _cond.wait(lock);
+                        continue;
+                    }
+                    size_t interval_ms = _entries[0].interval_ms;
+                    for (auto &e : _entries) interval_ms = std::min(interval_ms, e.interval_ms);
+                    _cond.wait_for(lock, std::chrono::milliseconds(interval_ms));
+                    for (size_t i = 0; i < _entries.size(); ++i) {
+                        Entry e = _entries[i];
+                        _current = e.arg;
+                        lock.unlock();
+                        e.tick(e.arg);
+                        lock.lock();
+                        _current = nullptr;
+                        _idle_cond.notify_all();
+                    }
+                }
+            }
+            // fork 期间持有 _mutex：线程此时不在修改登记表
+            static void prepareFork(void *arg) { static_cast<StdoutFlusher *>(arg)->_mutex.lock(); }
+            static void parentAfterFork(void *arg) { static_cast<StdoutFlusher *>(arg)->_mutex.unlock(); }
+            // 子进程：线程不存在了，重新构造条件变量并重新启动
+            static void childAfterFork(void *arg) {
+                StdoutFlusher *self = static_cast<StdoutFlusher *>(arg);
+                self->_current = nullptr;
+                new (&self->_cond) std::condition_variable();
+                new (&self->_idle_cond) std::condition_variable();
+                self->_mutex.unlock();
+                if (self->_started) std::thread(&StdoutFlusher::threadEntry, self).detach();
+            }
+        private:
+            std::mutex _mutex;
+            std::condition_variable _cond;
+            std::condition_variable _idle_cond;     // 一次 tick 结束
+            std::vector<Entry> _entries;
+            void *_current = nullptr;               // 正在 tick 的对象
+            bool _started = false;
     };
-    // 落地方向： 标准输出
+
+    /* 落地方向： 标准输出 / 标准错误
+       直接写文件描述符。每个写日志的线程有自己的暂存区（最多 STDOUT_STAGE_SIZE），只加自己暂存区的锁（没有其他线程争用），
+       所以同步日志器可以不加全局锁直接调用（concurrentSafe）；暂存区满时由该线程自己把它和新数据一次 writev 写出，
+       距上次写出超过 flush_interval_ms 时把所有线程的暂存区合成一次 writev 写出
+       （所有实例共用 StdoutFlusher 的一个线程定时检查，避免空闲时最后几行一直留在暂存区里；间隔为 0 时每次调用都写出）。
+       同一线程的日志保持顺序；不同线程的日志按暂存区成批写出，一个间隔内不按时间交错。
+       输出是终端且 color 为 true 时按等级加 ANSI 颜色，重定向到文件或管道时不加。
+       注意和 std::cout 混用时两者的输出顺序不保证 */
     class StdoutSink : public LogSink {
         public:
-            // 将日志消息写到标准输出,定长输出
-            void log(const std::string& data, size_t len) override {
-                //从0开始截取长度为len
-                std::string str(data, 0, len);
-                std::cout << str.c_str()<< std::endl;
+            StdoutSink(int fd = STDOUT_FILENO
+                , bool color = true
+                , size_t buffer_size = DEFAULT_STDOUT_BUFFER
+                , size_t flush_interval_ms = DEFAULT_STDOUT_FLUSH_MS)
+                : _fd(fd)
+                , _color(color && isatty(fd))
+                , _stage_size(std::max<size_t>(std::min<size_t>(buffer_size, STDOUT_STAGE_SIZE), 1))
+                , _interval_ms(flush_interval_ms)
+                , _id(nextId())
+            {
+                if (_interval_ms > 0)
+                    StdoutFlusher::getInstance().add(&StdoutSink::flushTick, this, _interval_ms);
+                // 进程崩溃时把暂存区中还没写出的内容写出
+                _crash_slot = CrashHandler::registerDrain(&StdoutSink::crashDrain, this);
+                _fork_slot = ForkHandler::registerHandler(&StdoutSink::prepareFork, &StdoutSink::parentAfterFork
+                    , &StdoutSink::childAfterFork, this);
+            }
+            ~StdoutSink() {
+                ForkHandler::unregisterHandler(_fork_slot);
+                CrashHandler::unregisterDrain(_crash_slot);
+                if (_interval_ms > 0) StdoutFlusher::getInstance().remove(this);
+                flush();
+                // 各线程的局部表里还引用着暂存区，先把内存还掉
+                for (auto &stage : _stages) {
+                    std::unique_lock<std::mutex> lock(stage->mutex);
+                    std::vector<char>().swap(stage->data);
+                }
+            }
+            void log(const char *data, size_t len) override {
+                Stage &st = stage();
+                std::unique_lock<std::mutex> lock(st.mutex);
+                put(st, data, len);
+                if (_interval_ms == 0) writeStage(st);
+            }
+            // 着色：颜色码 + 日志（不含换行）+ 复位码 + 换行
+            void logRecord(LogLevel::value level, const char *data, size_t len) override {
+                if (!_color) { log(data, len); return; }
+                bool newline = len > 0 && data[len - 1] == '\n';
+                const char *code = colorOf(level);
+                Stage &st = stage();
+                std::unique_lock<std::mutex> lock(st.mutex);
+                put(st, code, strlen(code));
+                put(st, data, newline ? len - 1 : len);
+                put(st, COLOR_RESET, sizeof(COLOR_RESET) - 1);
+                if (newline) put(st, "\n", 1);
+                if (_interval_ms == 0) writeStage(st);
+            }
+            // 不着色时整批连同各暂存区中的内容一次 writev 写出
+            void logRecords(Buffer &buf, LogLevel::value min_level) override {
+                if (_color || min_level > buf.minLevel()) { LogSink::logRecords(buf, min_level); return; }
+                const std::vector<struct iovec> &chunks = buf.iovecs();
+                std::unique_lock<std::mutex> lock(_mutex);
+                writeAllStages(chunks.data(), chunks.size());
+            }
+            bool levelAware() const override { return _color; }
+            void flush() override {
+                std::unique_lock<std::mutex> lock(_mutex);
+                writeAllStages(nullptr, 0);
+            }
+            std::string name() const override { return _fd == STDERR_FILENO ? "stderr" : "stdout"; }
+            void signalSafeWrite(const char *data, size_t len) override {
+                // 尽力而为：先把暂存区中还没写出的内容写出
+                crashDrain(this);
+                CrashHandler::writeAll(_fd, data, len);
+            }
+            // 每个线程只写自己的暂存区
+            bool concurrentSafe() const override { return true; }
+        private:
+            struct Stage {
+                std::mutex mutex;           // 平时只有所属线程使用，写出全部暂存区时才有争用
+                std::vector<char> data;
+                size_t used = 0;
+            };
+            static uint64_t nextId() {
+                static std::atomic<uint64_t> id(0);
+                return ++id;
+            }
+            /* 当前线程的暂存区：线程局部表按实例编号（不复用）查找，第一次使用时创建并登记到 _stages。
+               线程退出时局部表释放它的引用，定时写出时发现只剩 _stages 引用就写出并移除 */
+            Stage &stage() {
+                struct Local {
+                    uint64_t id = 0;            // 上一次使用的实例
+                    Stage *stage = nullptr;
+                    std::unordered_map<uint64_t, std::shared_ptr<Stage>> stages;
+                };
+                static thread_local Local local;
+                if (local.id == _id) return *local.stage;
+                std::shared_ptr<Stage> &st = local.stages[_id];
+                if (!st) {
+                    st = std::make_shared<Stage>();
+                    st->data.resize(_stage_size);
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _stages.push_back(st);
+                }
+                local.id = _id;
+                local.stage = st.get();
+                return *st;
+            }
+            // 放进暂存区；放不下时把暂存区和新数据用一次 writev 写出（持有该暂存区的锁）
+            void put(Stage &st, const char *data, size_t len) {
+                if (st.used + len <= st.data.size()) {
+                    memcpy(st.data.data() + st.used, data, len);
+                    st.used += len;
+                    return;
+                }
+                struct iovec iov[2] = {{st.data.data(), st.used}, {const_cast<char *>(data), len}};
+                if (!CrashHandler::writevAll(_fd, iov, 2)) reportError();
+                st.used = 0;
             }
+            void writeStage(Stage &st) {
+                if (st.used == 0) return;
+                if (!CrashHandler::writeAll(_fd, st.data.data(), st.used)) reportError();
+                st.used = 0;
+            }
+            /* 持有 _mutex 时调用：把所有暂存区和 extra 合成一次 writev 写出；
+               顺带移除所属线程已经退出的暂存区（写出之前就只剩 _stages 引用的，之后不会再有人写） */
+            void writeAllStages(const struct iovec *extra, size_t count) {
+                std::vector<std::unique_lock<std::mutex>> locks;
+                locks.reserve(_stages.size());
+                _iov.clear();
+                std::vector<Stage *> dead;
+                for (auto &st : _stages) {
+                    locks.emplace_back(st->mutex);
+                    if (st.use_count() == 1) dead.push_back(st.get());
+                    if (st->used > 0) _iov.push_back(iovec{st->data.data(), st->used});
+                }
+                _iov.insert(_iov.end(), extra, extra + count);
+                if (!_iov.empty() && !CrashHandler::writevAll(_fd, _iov.data(), (int)_iov.size())) reportError();
+                for (auto &st : _stages) st->used = 0;
+                locks.clear();
+                if (!dead.empty()) {
+                    _stages.erase(std::remove_if(_stages.begin(), _stages.end(), [&](const std::shared_ptr<Stage> &st) {
+                        return std::find(dead.begin(), dead.end(), st.get()) != dead.end();
+                    }), _stages.end());
+                }
+                _last_flush = std::chrono::steady_clock::now();
+            }
+            // StdoutFlusher 定时调用：距上次写出超过间隔时写出所有暂存区
+            static void flushTick(void *arg) {
+                StdoutSink *self = static_cast<StdoutSink *>(arg);
+                std::unique_lock<std::mutex> lock(self->_mutex);
+                if (std::chrono::steady_clock::now() - self->_last_flush >= std::chrono::milliseconds(self->_interval_ms))
+                    self->writeAllStages(nullptr, 0);
+            }
+            // 信号处理函数中调用：不加锁，尽力而为
+            static void crashDrain(void *arg) {
+                StdoutSink *self = static_cast<StdoutSink *>(arg);
+                for (auto &st : self->_stages) {
+                    CrashHandler::writeAll(self->_fd, st->data.data(), st->used);
+                    st->used = 0;
+                }
+            }
+            // fork 期间持有 _mutex 和所有暂存区的锁：拿到锁就说明没有人在写
+            static void prepareFork(void *arg) {
+                StdoutSink *self = static_cast<StdoutSink *>(arg);
+                self->_mutex.lock();
+                for (auto &st : self->_stages) st->mutex.lock();
+            }
+            static void parentAfterFork(void *arg) {
+                StdoutSink *self = static_cast<StdoutSink *>(arg);
+                for (auto &st : self->_stages) st->mutex.unlock();
+                self->_mutex.unlock();
+            }
+            // 子进程：暂存区中的内容由父进程写出，这里丢弃（定时写出线程由 StdoutFlusher 自己重新启动）
+            static void childAfterFork(void *arg) {
+                StdoutSink *self = static_cast<StdoutSink *>(arg);
+                for (auto &st : self->_stages) {
+                    st->used = 0;
+                    st->mutex.unlock();
+                }
+                self->_mutex.unlock();
+            }
+            static const char *colorOf(LogLevel::value level) {
+                switch (level) {
+                    case LogLevel::DEBUG: return "\033[36m";     // 青色
+                    case LogLevel::INFO:  return "\033[32m";     // 绿色
+                    case LogLevel::WARN:  return "\033[33m";     // 黄色
+                    case LogLevel::ERROR: return "\033[31m";     // 红色
+                    case LogLevel::FATAL: return "\033[1;31m";   // 加粗红色
+                    default: return "";
+                }
+            }
+            static constexpr const char COLOR_RESET[] = "\033[0m";
+        private:
+            int _fd;
+            bool _color;                    // 是否着色（仅终端）
+            size_t _stage_size;             // 每个线程暂存区的大小
+            size_t _interval_ms;            // 定时写出的间隔
+            uint64_t _id;                   // 实例编号，线程局部表按它查找暂存区
+            std::vector<std::shared_ptr<Stage>> _stages;   // 所有线程的暂存区，_mutex 保护
+            std::vector<struct iovec> _iov; // writeAllStages() 用
+            std::chrono::steady_clock::time_point _last_flush;
+            std::mutex _mutex;              // 保护 _stages，写出全部暂存区时持有
+            int _crash_slot = -1;
+            int _fork_slot = -1;
+    };
+    class StderrSink : public StdoutSink {
+        public:
+            StderrSink(bool color = true) : StdoutSink(STDERR_FILENO, color) {}
     };
     // 落地方向： 指定文件
     class FileSink : public LogSink {
         public: 
-            // 构造时传入文件名
-            FileSink(const std::string &pathname) {
+            /* 构造时传入文件名
+               direct 为 false（默认）时经 ofstream 缓冲写入，单线程吞吐最高；
+               为 true 时每次 log() 直接一次 write(2) 追加，内核保证追加位置的原子性，多个线程可以并发写，
+               同步日志器不再为它加锁，而且不经过用户态缓冲，进程崩溃也不丢已经写出的日志 */
+            FileSink(const std::string &pathname, bool direct = false)
+                : _pathname(pathname)
+                , _direct(direct)
+            {
                 // 1、 创建日志文件所在的目录
                 util::createDirectory(util::getDirectory(pathname));
                 // 2、 创建并打开日志文件
-                _ofs.open(pathname, std::ios::binary | std::ios::app);
+                if (!_direct) _ofs.open(pathname, std::ios::binary | std::ios::app);
+                // 3、 追加模式的描述符：direct 模式下用它写，否则供崩溃时绕过 ofstream 直接写入
+                _fd = ::open(pathname.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
             }
-            void log(const std::string& data, size_t len) override {
-                _ofs.write(data.c_str(), len);
-                if (_ofs.fail()) {
+            ~FileSink() { if (_fd >= 0) ::close(_fd); }
+            void log(const char *data, size_t len) override {
+                bool ok;
+                if (_direct) {
+                    ok = _fd >= 0 && CrashHandler::writeAll(_fd, data, len);
+                } else {
+                    _ofs.write(data, len);
+                    ok = !_ofs.fail();
+                }
+                if (!ok) {
+                    reportError();
                     std::cerr << "Failed to write to file." << std::endl;
                 }
             }
+            // direct 模式下整批一次 writev；O_APPEND 下一次 writev 的各段连续追加
+            void logRecords(Buffer &buf, LogLevel::value min_level) override {
+                if (!_direct || min_level > buf.minLevel()) { LogSink::logRecords(buf, min_level); return; }
+                std::vector<struct iovec> iov = buf.iovecs();
+                if (_fd < 0 || !CrashHandler::writevAll(_fd, iov.data(), (int)iov.size())) {
+                    reportError();
+                    std::cerr << "Failed to write to file." << std::endl;
+                }
+            }
+            void flush() override { if (!_direct) _ofs.flush(); }
+            std::string name() const override { return "file:" + _pathname; }
+            void signalSafeWrite(const char *data, size_t len) override {
+                if (_fd >= 0) CrashHandler::writeAll(_fd, data, len);
+            }
+            bool concurrentSafe() const override { return _direct; }
         private:
             std::string _pathname;
+            bool _direct;            // 是否不经缓冲直接追加
             std::ofstream _ofs;
+            int _fd = -1;            // 追加模式的文件描述符
     };
     // 落地方向： 滚动文件，按大小
+    // index_block 不为 0 时为每个文件写旁路索引（见 index.hpp），每 index_block 字节一条，供 log_query 跳过无关的段
     class RollBySizeSink : public LogSink {
         public:
             //用户决定文件基本名字和文件大小
-            RollBySizeSink(const std::string &basename, size_t max_size)
+            RollBySizeSink(const std::string &basename, size_t max_size, size_t index_block = 0)
                 : _basename(basename)
                 , _max_fsize(max_size)
                 , _cur_fsize(0)
                 , _name_count(0)
+                , _index(index_block)
+                , _indexed(index_block > 0)
             {
-                std::string pathname = createNewFile();
-                util::createDirectory(util::getDirectory(pathname));
-                _ofs.open(pathname, std::ios::binary | std::ios::app);
+                openFile(createNewFile());
+            }
+            ~RollBySizeSink() {
+                _ofs.flush();
+                _index.close();
+                if (_crash_fd >= 0) ::close(_crash_fd);
+            }
+            // 不知道等级和时间：按当前时间、所有等级登记到索引
+            void log(const char *data, size_t len) override{
+                append(data, len, LogLevel::OFF, 0);
+            }
+            void logRecord(LogLevel::value level, const char *data, size_t len) override {
+                append(data, len, level, 0);
+            }
+            // 建索引时逐条写入，带上记录头中的等级和时间
+            void logRecords(Buffer &buf, LogLevel::value min_level) override {
+                if (!_indexed) { LogSink::logRecords(buf, min_level); return; }
+                for (const RecordView &rec : buf.records())
+                    if (rec.level >= min_level) append(rec.data, rec.len, rec.level, rec.ts_ns);
             }
-            void log(const std::string& data, size_t len) override{
+            void flush() override { _ofs.flush(); }
+            std::string name() const override { return "roll:" + _basename; }
+            void signalSafeWrite(const char *data, size_t len) override {
+                int fd = _crash_fd;
+                if (fd >= 0) CrashHandler::writeAll(fd, data, len);
+            }
+        private:
+            void append(const char *data, size_t len, LogLevel::value level, uint64_t ts_ns) {
                 if (_cur_fsize + len >= _max_fsize) {
                     _ofs.close();                         // 关闭原来已经打开的文件
-                    std::string pathname = createNewFile();
                     _cur_fsize = 0;
-                    util::createDirectory(util::getDirectory(pathname));
-                    _ofs.open(pathname, std::ios::binary | std::ios::app);
+                    openFile(createNewFile());
                 }
-                _ofs.write(data.c_str(), len);
+                _ofs.write(data, len);
+                if (_ofs.fail()) reportError();
                 _cur_fsize += len;
+                if (_indexed) _index.add(ts_ns ? ts_ns : Buffer::nowNs(), level, len);
+            }
+            // 打开滚动文件，同时打开崩溃时使用的追加描述符
+            void openFile(const std::string &pathname) {
+                util::createDirectory(util::getDirectory(pathname));
+                _ofs.open(pathname, std::ios::binary | std::ios::app);
+                int old_fd = _crash_fd;
+                _crash_fd = ::open(pathname.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+                if (old_fd >= 0) ::close(old_fd);
+                // 索引从文件当前长度开始（同名文件已存在时是追加）
+                struct stat st;
+                if (_indexed) _index.open(pathname, _crash_fd >= 0 && fstat(_crash_fd, &st) == 0 ? st.st_size : 0);
             }
-        private:
             //根据时间创建新的滚动文件
             std::string createNewFile(){
                 _name_count += 1;
@@ -109,8 +574,12 @@ namespace MySpace{
             size_t _max_fsize;       // 记录文件允许存储最大数据量,超过大小就要切换文件
             size_t _cur_fsize;       // 记录当前文件已经写入数据大小
             size_t _name_count;      // 滚动文件数量
+            int _crash_fd = -1;      // 崩溃时使用的描述符
+            IndexWriter _index;      // 当前文件的旁路索引
+            bool _indexed;           // 是否写索引
     };
 
+#if LOG_WITH_MYSQL
     // 落地方向：MySQL 数据库（使用 MySQL Connector/C++）
     class MySQLSink : public LogSink {
         public:
@@ -167,8 +636,9 @@ namespace MySpace{
             }
 
             // 将日志写入 MySQL 数据库
-            void log(const std::string& data, size_t len) override {
+            void log(const char *data, size_t len) override {
                 if (!_connected || !_conn) {
+                    reportError();
                     std::cerr << "MySQL未连接，无法写入日志" << std::endl;
                     return;
                 }
@@ -177,30 +647,32 @@ namespace MySpace{
                 std::unique_lock<std::mutex> lock(_mutex);
 
                 try {
-                    // 提取日志内容（去除末尾换行符）
-                    std::string log_content(data, 0, len);
-                    if (!log_content.empty() && log_content.back() == '\n') {
-                        log_content.pop_back();
-                    }
-
-                    // 使用 PreparedStatement 防止 SQL 注入
+                    // 异步日志器交来的是一整批日志，按换行拆成单条，每条一行记录（不含换行符）
                     std::ostringstream sql;
                     sql << "INSERT INTO " << _table 
                         << " (log_content, log_time) VALUES (?, NOW())";
                     
+                    // 使用 PreparedStatement 防止 SQL 注入
                     std::unique_ptr<sql::PreparedStatement> pstmt(
                         _conn->prepareStatement(sql.str())
                     );
                     
-                    pstmt->setString(1, log_content);
-                    pstmt->executeUpdate();
+                    Simd::forEachLine(data, len, [&](const char *line, size_t line_len) {
+                        if (line_len == 0) return;
+                        pstmt->setString(1, std::string(line, line_len));
+                        pstmt->executeUpdate();
+                    });
                     
                 } catch (sql::SQLException &e) {
+                    reportError();
                     std::cerr << "MySQL插入日志失败: " << e.what() << std::endl;
                     std::cerr << "错误码: " << e.getErrorCode() << std::endl;
                 }
             }
 
+            std::string name() const override { return "mysql:" + _database + "." + _table; }
+            // log() 内部自己加锁
+            bool concurrentSafe() const override { return true; }
         private:
             // 创建日志表（如果不存在）
             void createTableIfNotExists() {
@@ -235,6 +707,667 @@ namespace MySpace{
             bool _connected;                            // 连接状态
             std::mutex _mutex;                          // 保护线程安全的互斥锁
     };
+#endif
+
+    /* 落地方向： 内存飞行记录器
+       所有等级的日志都以很低的代价写进固定大小的环形内存，平时从不落盘；
+       只有被触发时（ERROR/FATAL 日志、崩溃信号、调用 dump()）才把最近 capacity 字节写到 dump 文件。
+       环形内存按 RECORDER_SLOT_SIZE 分成槽位，写入方用一次原子加法领取连续的槽位后各自拷贝，不加锁；
+       每个槽位带序号（seqlock），dump 时跳过正在写或已被覆盖的槽位，长日志占连续多个槽位。
+       日志器交来的是 LogMsg 的二进制编码，dump 时才用 formatter 格式化，低于等级阈值的日志在调用线程中不做格式化。
+       达到触发等级的日志只通知 dump 线程（第一次触发时启动），格式化和写文件不在记录日志的线程中进行；flush() 等待已触发的 dump 完成 */
+    class FlightRecorderSink : public LogSink {
+        public:
+            FlightRecorderSink(const std::string &dump_path
+                , size_t capacity = DEFAULT_RECORDER_SIZE
+                , LogLevel::value trigger_level = LogLevel::ERROR
+                , std::shared_ptr<Formatter> formatter = nullptr)
+                : _count(std::max<size_t>(capacity / sizeof(Slot), 1))
+                , _ring(new Slot[_count]())
+                , _next(0)
+                , _dumped(0)
+                , _trigger_level(trigger_level)
+                , _formatter(formatter ? formatter : std::make_shared<Formatter>())
+                , _crash_buf(std::min<size_t>(_count * SLOT_DATA, 64 * 1024))
+            {
+                assert(capacity > 0);
+                util::createDirectory(util::getDirectory(dump_path));
+                _fd = ::open(dump_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+                _crash_slot = CrashHandler::registerDrain(&FlightRecorderSink::crashDump, this);
+                _fork_slot = ForkHandler::registerHandler(&FlightRecorderSink::prepareFork, &FlightRecorderSink::parentAfterFork
+                    , &FlightRecorderSink::childAfterFork, this);
+            }
+            ~FlightRecorderSink() {
+                {
+                    std::unique_lock<std::mutex> lock(_request_mutex);
+                    _stop = true;
+                    _request_cond.notify_all();
+                }
+                // dump 线程退出前做完已触发的 dump
+                if (_dumper.joinable()) _dumper.join();
+                ForkHandler::unregisterHandler(_fork_slot);
+                CrashHandler::unregisterDrain(_crash_slot);
+                if (_fd >= 0) ::close(_fd);
+            }
+            // 作为普通落地方向使用时只记录，不知道等级，不会自动触发
+            void log(const char *data, size_t len) override {
+                store(SLOT_TEXT, LogLevel::DEBUG, data, len);
+            }
+            // 记录一条已经格式化好的日志，等级达到触发等级时通知 dump 线程
+            void record(LogLevel::value level, const char *data, size_t len) {
+                store(SLOT_TEXT, level, data, len);
+                if (level >= _trigger_level) requestDump();
+            }
+            // 记录一条日志消息：只做二进制编码，dump 时才格式化
+            void record(const LogMsg &msg) {
+                static thread_local std::string encoded;
+                msg.encode(encoded);
+                store(0, msg._level, encoded.data(), encoded.size());
+                if (msg._level >= _trigger_level) requestDump();
+            }
+            /* 主动触发：在调用线程中把尚未 dump 过的最近数据写到 dump 文件。
+               拼接和输出用的缓冲区第一次 dump 时分配，之后复用 */
+            void dump() {
+                if (_fd < 0) return;
+                std::unique_lock<std::mutex> lock(_dump_mutex);
+                uint64_t end = _next.load(std::memory_order_acquire);
+                uint64_t begin = std::max<uint64_t>(_dumped.load(std::memory_order_relaxed), end > _count ? end - _count : 0);
+                if (_dump_buf.empty()) _dump_buf.resize(_count * SLOT_DATA);
+                _dump_out.assign(DUMP_HEAD);
+                forEachRecord(begin, end, _dump_buf.data(), _dump_buf.size(), [&](bool text, const char *data, size_t len) {
+                    if (text) _dump_out.append(data, len);
+                    else if (_dump_msg.decode(data, len)) _dump_out.append(_formatter->format(_dump_msg));
+                });
+                _dump_out.append(DUMP_TAIL);
+                CrashHandler::writeAll(_fd, _dump_out.data(), _dump_out.size());
+                _dumped.store(end, std::memory_order_relaxed);
+            }
+            // 等待此前触发的 dump 完成
+            void flush() override {
+                std::unique_lock<std::mutex> lock(_request_mutex);
+                uint64_t target = _requests;
+                _done_cond.wait(lock, [&]() { return _served >= target; });
+            }
+            LogLevel::value triggerLevel() const { return _trigger_level; }
+            std::string name() const override { return "recorder"; }
+            // 写入不加锁，dump 之间自己加锁
+            bool concurrentSafe() const override { return true; }
+        private:
+            static const uint8_t SLOT_TEXT  = 1;    // 已格式化的文本，否则是 LogMsg 编码
+            static const uint8_t SLOT_FIRST = 2;    // 一条日志的第一个槽位
+            static const uint8_t SLOT_LAST  = 4;    // 一条日志的最后一个槽位
+            static constexpr const char DUMP_HEAD[] = "======== flight recorder dump begin ========\n";
+            static constexpr const char DUMP_TAIL[] = "======== flight recorder dump end ========\n";
+            struct Slot {
+                std::atomic<uint64_t> seq;          // 写完后为槽位编号 + 1，正在写时为 0
+                uint16_t len;                       // 本槽位中的数据长度
+                uint8_t level;
+                uint8_t flags;
+                char data[RECORDER_SLOT_SIZE - 12];
+            };
+            static const size_t SLOT_DATA = sizeof(Slot::data);
+
+            // 记录日志的线程只登记请求并唤醒 dump 线程，连续的请求合并为一次 dump
+            void requestDump() {
+                if (_fd < 0) return;
+                std::unique_lock<std::mutex> lock(_request_mutex);
+                ++_requests;
+                if (!_dumper.joinable()) _dumper = std::thread(&FlightRecorderSink::dumperEntry, this);
+                _request_cond.notify_one();
+            }
+            void dumperEntry() {
+                std::unique_lock<std::mutex> lock(_request_mutex);
+                while (true) {
+                    _request_cond.wait(lock, [&]() { return _served < _requests || _stop; });
+                    if (_served >= _requests) return;
+                    uint64_t target = _requests;
+                    lock.unlock();
+                    dump();
+                    lock.lock();
+                    _served = std::max(_served, target);
+                    _done_cond.notify_all();
+                }
+            }
+
+            // 领取连续的槽位并拷贝进去；环形内存放不下的文本只保留尾部，放不下的编码无法解码，直接丢弃
+            void store(uint8_t kind, LogLevel::value level, const char *data, size_t len) {
+                if (len > _count * SLOT_DATA) {
+                    if (!(kind & SLOT_TEXT)) return;
+                    data += len - _count * SLOT_DATA;
+                    len = _count * SLOT_DATA;
+                }
+                size_t n = len == 0 ? 1 : (len + SLOT_DATA - 1) / SLOT_DATA;
+                uint64_t first = _next.fetch_add(n, std::memory_order_relaxed);
+                for (size_t k = 0; k < n; ++k) {
+                    Slot &slot = _ring[(first + k) % _count];
+                    slot.seq.store(0, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_release);
+                    size_t part = std::min(SLOT_DATA, len - k * SLOT_DATA);
+                    memcpy(slot.data, data + k * SLOT_DATA, part);
+                    slot.len = (uint16_t)part;
+                    slot.level = (uint8_t)level;
+                    slot.flags = kind | (k == 0 ? SLOT_FIRST : 0) | (k + 1 == n ? SLOT_LAST : 0);
+                    slot.seq.store(first + k + 1, std::memory_order_release);
+                }
+            }
+            // 读出编号为 index 的槽位；正在写或已被覆盖时返回 false（只用 memcpy，信号处理函数中也可以调用）
+            bool readSlot(uint64_t index, char *out, size_t &len, uint8_t &flags) const {
+                const Slot &slot = _ring[index % _count];
+                uint64_t seq = slot.seq.load(std::memory_order_acquire);
+                if (seq != index + 1) return false;
+                len = std::min<size_t>(slot.len, SLOT_DATA);
+                flags = slot.flags;
+                memcpy(out, slot.data, len);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return slot.seq.load(std::memory_order_relaxed) == seq;
+            }
+            /* 按顺序把 [begin, end) 中完整的日志交给 emit(是否文本, 数据, 长度)，buf 用来拼接跨槽位的日志。
+               开头已被覆盖、中间有槽位正在写、或者超过 buf 大小的日志跳过 */
+            template<class Emit>
+            void forEachRecord(uint64_t begin, uint64_t end, char *buf, size_t cap, Emit &&emit) const {
+                char part[SLOT_DATA];
+                size_t used = 0;
+                bool open = false;
+                for (uint64_t index = begin; index < end; ++index) {
+                    size_t len = 0;
+                    uint8_t flags = 0;
+                    if (!readSlot(index, part, len, flags)) { open = false; continue; }
+                    if (flags & SLOT_FIRST) { open = true; used = 0; }
+                    if (!open) continue;
+                    if (used + len > cap) { open = false; continue; }
+                    memcpy(buf + used, part, len);
+                    used += len;
+                    if (flags & SLOT_LAST) {
+                        emit((flags & SLOT_TEXT) != 0, buf, used);
+                        open = false;
+                    }
+                }
+            }
+            /* 崩溃时调用，只用 write(2)：信号处理函数中不能格式化，编码的日志按
+               [时间戳秒数][线程号][日志器][文件:行号][等级] 消息 输出 */
+            void dumpUnlocked() {
+                if (_fd < 0) return;
+                uint64_t end = _next.load(std::memory_order_acquire);
+                uint64_t begin = std::max<uint64_t>(_dumped.load(std::memory_order_relaxed), end > _count ? end - _count : 0);
+                CrashHandler::writeAll(_fd, DUMP_HEAD, sizeof(DUMP_HEAD) - 1);
+                forEachRecord(begin, end, _crash_buf.data(), _crash_buf.size(), [&](bool text, const char *data, size_t len) {
+                    if (text) { CrashHandler::writeAll(_fd, data, len); return; }
+                    LogMsg::View view;
+                    if (!LogMsg::peek(data, len, view)) return;
+                    const char *level = LogLevel::toCString(view.level);
+                    auto put = [&](const char *str, size_t n) { CrashHandler::writeAll(_fd, str, n); };
+                    auto number = [&](uint64_t value) {
+                        char num[24];
+                        put(num, std::to_chars(num, num + sizeof(num), value).ptr - num);
+                    };
+                    put("[", 1); number((uint64_t)view.ctime);
+                    put("][", 2); number(view.tid);
+                    put("][", 2); put(view.logger.data(), view.logger.size());
+                    put("][", 2); put(view.file.data(), view.file.size());
+                    put(":", 1); number(view.line);
+                    put("][", 2); put(level, strlen(level));
+                    put("] ", 2); put(view.payload.data(), view.payload.size());
+                    CrashHandler::writeAll(_fd, "\n", 1);
+                });
+                CrashHandler::writeAll(_fd, DUMP_TAIL, sizeof(DUMP_TAIL) - 1);
+                _dumped.store(end, std::memory_order_relaxed);
+            }
+            static void crashDump(void *arg) {
+                static_cast<FlightRecorderSink *>(arg)->dumpUnlocked();
+            }
+            // fork 期间持有两把锁：dump 线程此时不在 dump，请求计数也不会变
+            static void prepareFork(void *arg) {
+                FlightRecorderSink *self = static_cast<FlightRecorderSink *>(arg);
+                self->_request_mutex.lock();
+                self->_dump_mutex.lock();
+            }
+            static void parentAfterFork(void *arg) {
+                FlightRecorderSink *self = static_cast<FlightRecorderSink *>(arg);
+                self->_dump_mutex.unlock();
+                self->_request_mutex.unlock();
+            }
+            /* 子进程：dump 线程不存在了，父进程已触发的 dump 由父进程完成；线程在下一次触发时重新启动 */
+            static void childAfterFork(void *arg) {
+                FlightRecorderSink *self = static_cast<FlightRecorderSink *>(arg);
+                new (&self->_dumper) std::thread();
+                new (&self->_request_cond) std::condition_variable();
+                new (&self->_done_cond) std::condition_variable();
+                self->_served = self->_requests;
+                self->_dump_mutex.unlock();
+                self->_request_mutex.unlock();
+            }
+        private:
+            size_t _count;                          // 槽位数
+            std::unique_ptr<Slot[]> _ring;          // 环形槽位
+            std::atomic<uint64_t> _next;            // 下一个要领取的槽位编号，编号 % _count 即位置
+            std::atomic<uint64_t> _dumped;          // 已经 dump 到的槽位编号，避免重复输出
+            LogLevel::value _trigger_level;         // 触发 dump 的等级
+            std::shared_ptr<Formatter> _formatter;  // dump 时格式化编码的日志
+            std::vector<char> _crash_buf;           // 崩溃时拼接跨槽位的日志，预先分配
+            int _fd = -1;                           // dump 文件描述符，预先打开以便崩溃时使用
+            int _crash_slot = -1;                   // 崩溃回调槽位
+            int _fork_slot = -1;
+            std::mutex _dump_mutex;                 // 只在 dump 之间互斥，保护下面三个复用的对象
+            std::vector<char> _dump_buf;            // 拼接跨槽位的日志
+            std::string _dump_out;                  // 一次 dump 的输出
+            LogMsg _dump_msg{LogLevel::DEBUG, 0, "", "", ""};
+            std::mutex _request_mutex;              // 保护 dump 请求计数和 dump 线程
+            std::condition_variable _request_cond;  // 唤醒 dump 线程
+            std::condition_variable _done_cond;     // 一次 dump 完成
+            uint64_t _requests = 0;                 // 触发次数
+            uint64_t _served = 0;                   // 已经 dump 完成的触发次数
+            bool _stop = false;
+            std::thread _dumper;                    // dump 线程，第一次触发时启动
+    };
+
+    // 网络落地方向的参数
+    struct NetworkSinkOptions {
+        enum Protocol {
+            SYSLOG_UDP,     // RFC 5424 over UDP，每条一个数据报
+            SYSLOG_TCP,     // RFC 5424 over TCP，RFC 6587 octet-counting 分帧（"长度 空格 消息"）
+            TCP             // 通用 TCP 收集端，每条前面是 4 字节大端长度
+        };
+        Protocol protocol = SYSLOG_UDP;
+        std::string host = "127.0.0.1";         // 收集端地址（构造时解析一次）
+        uint16_t port = 514;
+        std::string app_name = "mylog";         // syslog APP-NAME
+        int facility = 1;                       // syslog facility，1 为 user
+        int severity = 6;                       // 不知道日志等级时（整块写入、崩溃暂存）使用的 syslog severity，6 为 informational
+        size_t max_block_ms = DEFAULT_NET_BLOCK_MS;     // 每次 log()/flush() 最多阻塞的时间
+        size_t backoff_min_ms = 100;            // 重连退避的初始间隔，每次失败翻倍
+        size_t backoff_max_ms = 30000;          // 重连退避的最大间隔
+        std::string spill_path;                 // 收集端不可用时暂存日志的文件，为空则只在内存中排队
+        size_t spill_max_bytes = DEFAULT_SPILL_SIZE;    // 暂存文件（或内存队列）的上限，超出的日志丢弃
+        size_t max_datagram = MAX_UDP_DATAGRAM;         // UDP：单条消息的上限，超出的部分截断（RFC 5426 允许发送端截断）
+    };
+
+    /* 落地方向：网络（syslog / TCP 收集端）
+       套接字为非阻塞，每次调用最多阻塞 max_block_ms，超时未发完的留到下次，因此不会长时间卡住异步工作线程。
+       一批日志拆成单条后分帧拼在一起，TCP 一次 send、UDP 一次 sendmmsg 发出多条。
+       连接失败按指数退避重连；连不上或发送积压时新日志写入暂存文件，恢复后按顺序补发（至少一次，进程中途退出可能重复）。*/
+    class NetworkSink : public LogSink {
+        public:
+            NetworkSink(const NetworkSinkOptions &options)
+                : _opt(options)
+                , _backoff_ms(options.backoff_min_ms)
+            {
+                resolve();
+                char host[256] = "-";
+                if (gethostname(host, sizeof(host) - 1) != 0 || host[0] == '\0') strcpy(host, "-");
+                // HEADER 中时间戳之后的固定部分：HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA
+                _header_tail = std::string(" ") + host + " " + _opt.app_name + " " + std::to_string(getpid()) + " - - ";
+                // 崩溃时来不及取时间，时间戳用 NILVALUE
+                _crash_header = "<" + std::to_string(_opt.facility * 8 + _opt.severity) + ">1 -" + _header_tail;
+                if (!_opt.spill_path.empty()) {
+                    util::createDirectory(util::getDirectory(_opt.spill_path));
+                    _spill_fd = ::open(_opt.spill_path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+                    struct stat st;
+                    // 上次运行没发出去的日志也会补发
+                    if (_spill_fd >= 0 && fstat(_spill_fd, &st) == 0) _spill_size = st.st_size;
+                }
+                Simd::isa();
+            }
+            ~NetworkSink() {
+                drain(StatsClock::nowNs() + _opt.max_block_ms * 1000000ull);
+                closeSocket();
+                if (_spill_fd >= 0) ::close(_spill_fd);
+            }
+            void log(const char *data, size_t len) override {
+                uint64_t deadline = StatsClock::nowNs() + _opt.max_block_ms * 1000000ull;
+                bool direct = prepare(deadline);
+                queueLines(_opt.severity, data, len, direct);
+                drain(deadline);
+            }
+            // syslog 的 PRI 按每条日志的等级取 severity
+            void logRecord(LogLevel::value level, const char *data, size_t len) override {
+                uint64_t deadline = StatsClock::nowNs() + _opt.max_block_ms * 1000000ull;
+                bool direct = prepare(deadline);
+                queueLines(severityOf(level), data, len, direct);
+                drain(deadline);
+            }
+            // 整批记录：逐条取等级组帧，最后一次发送
+            void logRecords(Buffer &buf, LogLevel::value min_level) override {
+                if (!levelAware()) { LogSink::logRecords(buf, min_level); return; }
+                uint64_t deadline = StatsClock::nowNs() + _opt.max_block_ms * 1000000ull;
+                bool direct = prepare(deadline);
+                for (const RecordView &rec : buf.records())
+                    if (rec.level >= min_level) queueLines(severityOf(rec.level), rec.data, rec.len, direct);
+                drain(deadline);
+            }
+            bool levelAware() const override { return _opt.protocol != NetworkSinkOptions::TCP; }
+            void flush() override {
+                drain(StatsClock::nowNs() + _opt.max_block_ms * 1000000ull);
+            }
+            std::string name() const override {
+                static const char *protocols[] = {"syslog-udp", "syslog-tcp", "tcp"};
+                return std::string(protocols[_opt.protocol]) + ":" + _opt.host + ":" + std::to_string(_opt.port);
+            }
+            // 崩溃时只能写暂存文件，下次启动后补发
+            void signalSafeWrite(const char *data, size_t len) override {
+                if (_spill_fd < 0) return;
+                Simd::forEachLine(data, len, [&](const char *line, size_t line_len) {
+                    if (line_len == 0) return;
+                    bool syslog = _opt.protocol != NetworkSinkOptions::TCP;
+                    uint32_t total = (uint32_t)(line_len + (syslog ? _crash_header.size() : 0));
+                    CrashHandler::writeAll(_spill_fd, reinterpret_cast<const char *>(&total), sizeof(total));
+                    if (syslog) CrashHandler::writeAll(_spill_fd, _crash_header.data(), _crash_header.size());
+                    CrashHandler::writeAll(_spill_fd, line, line_len);
+                });
+            }
+            bool connected() const { return _connected; }
+            // 因暂存已满、连接中断时发了一半、数据报过大等原因丢弃的日志条数
+            uint64_t dropped() const { return _dropped; }
+            // UDP：超过 max_datagram 被截断的日志条数
+            uint64_t truncated() const { return _truncated; }
+        private:
+            // 一帧在 _out 中的位置
+            struct Frame {
+                size_t begin;   // 帧起始（含分帧头）
+                size_t end;
+            };
+            void resolve() {
+                struct addrinfo hints, *res = nullptr;
+                memset(&hints, 0, sizeof(hints));
+                hints.ai_family = AF_UNSPEC;
+                hints.ai_socktype = _opt.protocol == NetworkSinkOptions::SYSLOG_UDP ? SOCK_DGRAM : SOCK_STREAM;
+                std::string port = std::to_string(_opt.port);
+                if (getaddrinfo(_opt.host.c_str(), port.c_str(), &hints, &res) != 0 || !res) {
+                    std::cerr << "解析收集端地址失败: " << _opt.host << std::endl;
+                    return;
+                }
+                memcpy(&_addr, res->ai_addr, res->ai_addrlen);
+                _addrlen = res->ai_addrlen;
+                freeaddrinfo(res);
+            }
+            // 更新时间戳并尝试连接；只有在前面没有积压时才直接发送（返回 true），否则追加到暂存文件，保证顺序
+            bool prepare(uint64_t deadline) {
+                updateTimestamp();
+                return _spill_fd < 0 || (connect(deadline) && _frames.empty() && _spill_read == _spill_size);
+            }
+            void queueLines(int severity, const char *data, size_t len, bool direct) {
+                Simd::forEachLine(data, len, [&](const char *line, size_t line_len) {
+                    if (line_len == 0) return;
+                    buildMessage(severity, line, line_len);
+                    if (direct) queueFrame(_msg.data(), _msg.size());
+                    else spill(_msg.data(), _msg.size());
+                });
+            }
+            // 日志等级 -> syslog severity（RFC 5424 6.2.1）
+            static int severityOf(LogLevel::value level) {
+                switch (level) {
+                    case LogLevel::DEBUG: return 7;   // Debug
+                    case LogLevel::INFO:  return 6;   // Informational
+                    case LogLevel::WARN:  return 4;   // Warning
+                    case LogLevel::ERROR: return 3;   // Error
+                    case LogLevel::FATAL: return 2;   // Critical
+                    default: return 5;                // Notice
+                }
+            }
+            // RFC 5424 TIMESTAMP，每批计算一次
+            void updateTimestamp() {
+                if (_opt.protocol == NetworkSinkOptions::TCP) return;
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                struct tm t;
+                gmtime_r(&ts.tv_sec, &t);
+                char buf[64];
+                size_t n = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &t);
+                snprintf(buf + n, sizeof(buf) - n, ".%06ldZ", ts.tv_nsec / 1000);
+                _timestamp = buf;
+            }
+            // 一条日志转成要发送的消息（不含分帧头），放在 _msg 中
+            void buildMessage(int severity, const char *line, size_t len) {
+                _msg.clear();
+                if (_opt.protocol != NetworkSinkOptions::TCP) {
+                    _msg.push_back('<');
+                    _msg.append(std::to_string(_opt.facility * 8 + severity));
+                    _msg.append(">1 ");
+                    _msg.append(_timestamp);
+                    _msg.append(_header_tail);
+                }
+                _msg.append(line, len);
+            }
+            // 加上分帧头放入发送队列；队列超过上限时丢弃。UDP 的消息超过数据报上限时截断，否则永远发不出去
+            void queueFrame(const char *msg, size_t len) {
+                if (_opt.protocol == NetworkSinkOptions::SYSLOG_UDP && len > _opt.max_datagram) {
+                    len = _opt.max_datagram;
+                    _truncated++;
+                }
+                if (_out.size() - _out_sent + len > _opt.spill_max_bytes) {
+                    _dropped++;
+                    reportError();
+                    return;
+                }
+                Frame frame;
+                frame.begin = _out.size();
+                if (_opt.protocol == NetworkSinkOptions::SYSLOG_TCP) {
+                    _out.append(std::to_string(len));
+                    _out.push_back(' ');
+                } else if (_opt.protocol == NetworkSinkOptions::TCP) {
+                    uint32_t be = htonl((uint32_t)len);
+                    _out.append(reinterpret_cast<const char *>(&be), sizeof(be));
+                }
+                _out.append(msg, len);
+                frame.end = _out.size();
+                _frames.push_back(frame);
+            }
+            // 追加到暂存文件：4 字节长度 + 消息
+            void spill(const char *msg, size_t len) {
+                if (_spill_size + sizeof(uint32_t) + len > _opt.spill_max_bytes) {
+                    _dropped++;
+                    reportError();
+                    return;
+                }
+                uint32_t n = (uint32_t)len;
+                struct iovec iov[2] = {{&n, sizeof(n)}, {const_cast<char *>(msg), len}};
+                ssize_t ret = ::writev(_spill_fd, iov, 2);
+                if (ret != (ssize_t)(sizeof(n) + len)) {
+                    _dropped++;
+                    reportError();
+                    return;
+                }
+                _spill_size += ret;
+            }
+            // 从暂存文件读出下一段（最多约 64K）放入发送队列，没有数据时返回 false
+            bool loadSpill() {
+                size_t loaded = 0;
+                while (_spill_read < _spill_size && loaded < 64 * 1024) {
+                    uint32_t len = 0;
+                    if (::pread(_spill_fd, &len, sizeof(len), _spill_read) != (ssize_t)sizeof(len)
+                        || _spill_read + sizeof(len) + len > _spill_size) {
+                        // 文件尾部不完整（例如崩溃时写了一半），整个丢弃
+                        _spill_read = _spill_size;
+                        break;
+                    }
+                    _msg.resize(len);
+                    if (::pread(_spill_fd, &_msg[0], len, _spill_read + sizeof(len)) != (ssize_t)len) {
+                        _spill_read = _spill_size;
+                        break;
+                    }
+                    _spill_read += sizeof(len) + len;
+                    queueFrame(_msg.data(), _msg.size());
+                    loaded += len;
+                }
+                // 只跳过了损坏的尾部、没有要发的帧时直接确认
+                if (_frames.empty()) commitSpill();
+                return loaded > 0;
+            }
+            /* 发送队列清空后调用：此前从暂存文件读出的帧都已发出，确认位置推进到 _spill_read。
+               暂存文件全部确认后才清空，读出但还没发出的日志在进程退出后仍留在文件里，下次启动补发 */
+            void commitSpill() {
+                _spill_committed = _spill_read;
+                if (_spill_committed >= _spill_size && _spill_size > 0) {
+                    if (::ftruncate(_spill_fd, 0) != 0) reportError();
+                    _spill_read = _spill_size = _spill_committed = 0;
+                }
+            }
+            // 在截止时间前尽量发送：先发队列，再补发暂存文件；全部发完返回 true
+            bool drain(uint64_t deadline) {
+                while (true) {
+                    if (!_frames.empty()) {
+                        if (!connect(deadline) || !sendOut(deadline)) return false;
+                    }
+                    if (_spill_fd < 0 || _spill_read >= _spill_size) return true;
+                    if (!connect(deadline) || !loadSpill()) return _frames.empty();
+                }
+            }
+            bool sendOut(uint64_t deadline) {
+                if (_opt.protocol == NetworkSinkOptions::SYSLOG_UDP) return sendDatagrams(deadline);
+                while (_out_sent < _out.size()) {
+                    ssize_t n = ::send(_fd, _out.data() + _out_sent, _out.size() - _out_sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+                    if (n > 0) { _out_sent += n; continue; }
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                        if (!waitWritable(deadline)) return false;
+                        continue;
+                    }
+                    disconnect();
+                    return false;
+                }
+                clearOut();
+                return true;
+            }
+            // UDP：每条一个数据报，用 sendmmsg 一次发出多条
+            bool sendDatagrams(uint64_t deadline) {
+                const size_t BATCH = 64;
+                struct mmsghdr msgs[BATCH];
+                struct iovec iovs[BATCH];
+                while (_frames_sent < _frames.size()) {
+                    size_t n = std::min(BATCH, _frames.size() - _frames_sent);
+                    for (size_t i = 0; i < n; ++i) {
+                        const Frame &f = _frames[_frames_sent + i];
+                        iovs[i].iov_base = &_out[f.begin];
+                        iovs[i].iov_len = f.end - f.begin;
+                        memset(&msgs[i], 0, sizeof(msgs[i]));
+                        msgs[i].msg_hdr.msg_iov = &iovs[i];
+                        msgs[i].msg_hdr.msg_iovlen = 1;
+                    }
+                    int sent = ::sendmmsg(_fd, msgs, n, MSG_DONTWAIT);
+                    if (sent > 0) { _frames_sent += sent; continue; }
+                    if (sent < 0 && errno == EINTR) continue;
+                    // 这一帧本身发不出去（比 max_datagram 设置的还大于内核上限），重连也没用：丢弃它，继续发后面的
+                    if (sent < 0 && errno == EMSGSIZE) {
+                        _frames_sent++;
+                        _dropped++;
+                        reportError();
+                        continue;
+                    }
+                    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                        if (!waitWritable(deadline)) return false;
+                        continue;
+                    }
+                    disconnect();
+                    return false;
+                }
+                clearOut();
+                return true;
+            }
+            void clearOut() {
+                _out.clear();
+                _frames.clear();
+                _out_sent = 0;
+                _frames_sent = 0;
+                if (_spill_fd >= 0) commitSpill();
+            }
+            // 建立连接（非阻塞），处于退避期间或截止时间内没有连上返回 false
+            bool connect(uint64_t deadline) {
+                if (_connected) return true;
+                if (_addrlen == 0) return false;
+                if (_fd < 0) {
+                    if (StatsClock::nowNs() < _next_connect_ns) return false;
+                    int type = _opt.protocol == NetworkSinkOptions::SYSLOG_UDP ? SOCK_DGRAM : SOCK_STREAM;
+                    _fd = ::socket(_addr.ss_family, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                    if (_fd < 0) { connectFailed(); return false; }
+                    if (::connect(_fd, reinterpret_cast<struct sockaddr *>(&_addr), _addrlen) == 0) {
+                        connectSucceeded();
+                        return true;
+                    }
+                    if (errno != EINPROGRESS) { connectFailed(); return false; }
+                }
+                // 非阻塞连接进行中
+                if (!waitWritable(deadline)) return false;
+                int err = 0;
+                socklen_t len = sizeof(err);
+                if (getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+                    connectFailed();
+                    return false;
+                }
+                connectSucceeded();
+                return true;
+            }
+            void connectSucceeded() {
+                _connected = true;
+                _backoff_ms = _opt.backoff_min_ms;
+                if (_opt.protocol != NetworkSinkOptions::SYSLOG_UDP) {
+                    int one = 1;
+                    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                }
+            }
+            void connectFailed() {
+                closeSocket();
+                reportError();
+                _next_connect_ns = StatsClock::nowNs() + _backoff_ms * 1000000ull;
+                _backoff_ms = std::min(_backoff_ms * 2, _opt.backoff_max_ms);
+            }
+            /* 连接中断：已经发出一部分的那一帧无法在新连接上续发，丢弃；之后的完整帧保留，重连后重发 */
+            void disconnect() {
+                if (_opt.protocol == NetworkSinkOptions::SYSLOG_UDP) {
+                    _frames.erase(_frames.begin(), _frames.begin() + _frames_sent);
+                } else {
+                    size_t keep = 0;
+                    while (keep < _frames.size() && _frames[keep].begin < _out_sent) ++keep;
+                    if (keep > 0 && _frames[keep - 1].end > _out_sent) {
+                        _dropped++;
+                        reportError();
+                    }
+                    _frames.erase(_frames.begin(), _frames.begin() + keep);
+                }
+                size_t base = _frames.empty() ? _out.size() : _frames.front().begin;
+                _out.erase(0, base);
+                for (auto &f : _frames) { f.begin -= base; f.end -= base; }
+                _out_sent = 0;
+                _frames_sent = 0;
+                connectFailed();
+            }
+            void closeSocket() {
+                if (_fd >= 0) ::close(_fd);
+                _fd = -1;
+                _connected = false;
+            }
+            bool waitWritable(uint64_t deadline) {
+                while (true) {
+                    uint64_t now = StatsClock::nowNs();
+                    if (now >= deadline) return false;
+                    struct pollfd pfd = {_fd, POLLOUT, 0};
+                    int ret = ::poll(&pfd, 1, (int)((deadline - now + 999999) / 1000000));
+                    if (ret > 0) return true;
+                    if (ret == 0) return false;
+                    if (errno != EINTR) return false;
+                }
+            }
+        private:
+            NetworkSinkOptions _opt;
+            struct sockaddr_storage _addr;
+            socklen_t _addrlen = 0;
+            int _fd = -1;
+            bool _connected = false;
+            size_t _backoff_ms;                 // 下一次重连失败后的等待时间
+            uint64_t _next_connect_ns = 0;      // 退避期间不尝试连接
+            std::string _header_tail;           // 时间戳之后的固定头部
+            std::string _crash_header;          // 崩溃时使用的完整头部
+            std::string _timestamp;             // 当前批次的时间戳
+            std::string _msg;                   // 组装单条消息用
+            std::string _out;                   // 已分帧、待发送的数据
+            std::vector<Frame> _frames;         // _out 中各帧的位置
+            size_t _out_sent = 0;               // TCP：_out 中已发出的字节数
+            size_t _frames_sent = 0;            // UDP：已发出的帧数
+            int _spill_fd = -1;                 // 暂存文件
+            size_t _spill_size = 0;             // 暂存文件大小
+            size_t _spill_read = 0;             // 暂存文件中已读入发送队列的位置
+            size_t _spill_committed = 0;        // 暂存文件中确认已发出的位置，全部确认后才清空文件
+            uint64_t _dropped = 0;
+            uint64_t _truncated = 0;
+    };
 
     class SinkFactory {
         public:
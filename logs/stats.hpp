@@ -0,0 +1,170 @@
+//stats.hpp
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstdint>
+
+#define STATS_SHARDS 16      // 计数器分片数（2 的幂）
+#define STATS_BUCKETS 64     // 直方图按 2 的幂分桶
+
+/*
+    日志流水线的内部统计：计数器按线程分片，热路径上只是对本线程分片的一次 relaxed 原子加；
+    直方图按 2 的幂分桶，只在较慢的路径（生产者阻塞、批处理、落地调用）上记录。
+*/
+namespace MySpace{
+    class StatsClock {
+        public:
+            static uint64_t nowNs() {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+    };
+
+    // 按线程分片的计数器，各分片独占缓存行，避免多线程同时累加时的伪共享
+    class ShardedCounter {
+        public:
+            ShardedCounter() { for (auto &s : _shards) s.value.store(0, std::memory_order_relaxed); }
+            void add(uint64_t n = 1) {
+                _shards[shard()].value.fetch_add(n, std::memory_order_relaxed);
+            }
+            uint64_t value() const {
+                uint64_t sum = 0;
+                for (auto &s : _shards) sum += s.value.load(std::memory_order_relaxed);
+                return sum;
+            }
+        private:
+            // 每个线程第一次使用时轮流分配一个分片
+            static size_t shard() {
+                static std::atomic<size_t> next(0);
+                static thread_local size_t idx = next.fetch_add(1, std::memory_order_relaxed) & (STATS_SHARDS - 1);
+                return idx;
+            }
+            struct alignas(64) Shard { std::atomic<uint64_t> value; };
+            Shard _shards[STATS_SHARDS];
+    };
+
+    // 直方图快照
+    struct HistogramSnapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        uint64_t buckets[STATS_BUCKETS] = {};   // buckets[i] 统计 [2^(i-1), 2^i) 范围的值，buckets[0] 统计 0
+
+        double mean() const { return count ? (double)sum / count : 0.0; }
+        // 百分位数（返回所在桶的上界，最大不超过 max）
+        uint64_t percentile(double q) const {
+            if (count == 0) return 0;
+            uint64_t rank = (uint64_t)(q * (double)(count - 1)) + 1, seen = 0;
+            for (int i = 0; i < STATS_BUCKETS; ++i) {
+                seen += buckets[i];
+                if (seen >= rank) {
+                    uint64_t upper = i == 0 ? 0 : (i >= 63 ? UINT64_MAX : ((uint64_t)1 << i) - 1);
+                    return upper < max ? upper : max;
+                }
+            }
+            return max;
+        }
+    };
+
+    // 2 的幂分桶直方图，可多线程并发记录
+    class Log2Histogram {
+        public:
+            Log2Histogram() {
+                for (auto &b : _buckets) b.store(0, std::memory_order_relaxed);
+                _sum.store(0); _max.store(0);
+            }
+            // 总数由各桶求和得到，记录一次只有两次原子加（最大值通常只需一次读）
+            void record(uint64_t v) {
+                int idx = v == 0 ? 0 : 64 - __builtin_clzll(v);
+                if (idx >= STATS_BUCKETS) idx = STATS_BUCKETS - 1;
+                _buckets[idx].fetch_add(1, std::memory_order_relaxed);
+                _sum.fetch_add(v, std::memory_order_relaxed);
+                uint64_t cur = _max.load(std::memory_order_relaxed);
+                while (v > cur && !_max.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+            }
+            HistogramSnapshot snapshot() const {
+                HistogramSnapshot s;
+                for (int i = 0; i < STATS_BUCKETS; ++i) {
+                    s.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+                    s.count += s.buckets[i];
+                }
+                s.sum = _sum.load(std::memory_order_relaxed);
+                s.max = _max.load(std::memory_order_relaxed);
+                return s;
+            }
+        private:
+            std::atomic<uint64_t> _buckets[STATS_BUCKETS];
+            std::atomic<uint64_t> _sum;
+            std::atomic<uint64_t> _max;
+    };
+
+    // 单个落地方向的统计
+    struct SinkStats {
+        std::atomic<uint64_t> bytes{0};       // 写入字节数
+        std::atomic<uint64_t> errors{0};      // 写入失败次数
+        Log2Histogram latency_ns;             // 每次 log() 的耗时
+    };
+    struct SinkStatsSnapshot {
+        std::string name;
+        uint64_t writes = 0;
+        uint64_t bytes = 0;
+        uint64_t errors = 0;
+        HistogramSnapshot latency_ns;
+    };
+
+    // 异步工作器的统计
+    struct LooperStats {
+        std::atomic<uint64_t> producer_waits{0};  // 生产者因缓冲区满而阻塞的次数
+        Log2Histogram producer_wait_ns;           // 每次阻塞的时长
+        std::atomic<uint64_t> buffer_swaps{0};    // 缓冲区交换次数
+        Log2Histogram batch_bytes;                // 每批字节数
+        Log2Histogram batch_records;              // 每批记录数
+        std::atomic<uint64_t> high_water{0};      // 生产缓冲区交换时的最大占用
+        std::atomic<uint64_t> capacity{0};        // 生产缓冲区当前容量
+        std::atomic<uint64_t> index_bytes{0};     // 两个缓冲区记录索引占用的字节数
+        std::atomic<uint64_t> idle_trims{0};      // 空闲回收的次数
+    };
+
+    // 日志器统计快照，由 Logger::stats() 返回
+    struct LoggerStatsSnapshot {
+        std::string logger;
+        uint64_t filtered = 0;            // 被等级过滤掉的调用
+        uint64_t logged = 0;              // 格式化并交给落地的日志条数
+        uint64_t bytes_formatted = 0;     // 格式化产生的字节数
+        bool asynch = false;
+        uint64_t producer_waits = 0;
+        HistogramSnapshot producer_wait_ns;
+        uint64_t buffer_swaps = 0;
+        HistogramSnapshot batch_bytes;
+        HistogramSnapshot batch_records;
+        uint64_t buffer_high_water = 0;
+        uint64_t buffer_capacity = 0;
+        uint64_t memory_bytes = 0;        // 日志器自身占用的缓冲区内存（Logger::memoryFootprint()）
+        uint64_t idle_trims = 0;
+        std::vector<SinkStatsSnapshot> sinks;
+
+        // 转成一行便于输出到日志的文本
+        std::string toString() const {
+            std::ostringstream out;
+            out << "[stats][" << logger << "] filtered=" << filtered
+                << " logged=" << logged << " bytes=" << bytes_formatted;
+            if (asynch) {
+                out << " swaps=" << buffer_swaps
+                    << " batch_bytes(mean/p99/max)=" << (uint64_t)batch_bytes.mean() << "/" << batch_bytes.percentile(0.99) << "/" << batch_bytes.max
+                    << " batch_records(mean/max)=" << (uint64_t)batch_records.mean() << "/" << batch_records.max
+                    << " producer_waits=" << producer_waits << " wait_ns(p99/max)=" << producer_wait_ns.percentile(0.99) << "/" << producer_wait_ns.max
+                    << " high_water=" << buffer_high_water << "/" << buffer_capacity
+                    << " memory=" << memory_bytes << " idle_trims=" << idle_trims;
+            }
+            for (auto &s : sinks) {
+                out << " sink{" << s.name << " writes=" << s.writes << " bytes=" << s.bytes << " errors=" << s.errors
+                    << " ns(p50/p99/max)=" << s.latency_ns.percentile(0.5) << "/" << s.latency_ns.percentile(0.99) << "/" << s.latency_ns.max << "}";
+            }
+            out << "\n";
+            return out.str();
+        }
+    };
+}
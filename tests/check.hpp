@@ -0,0 +1,36 @@
+//check.hpp
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+// 测试用的断言：失败时打印位置并立即以 1 退出（不跑 atexit，避免卡在日志器的退出流程里）
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) 失败\n", __FILE__, __LINE__, #cond); \
+            fflush(stderr); \
+            std::_Exit(1); \
+        } \
+    } while (0)
+
+namespace LogTest{
+    // 读整个文件，不存在时返回空串
+    inline std::string readFile(const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+    inline size_t countOf(const std::string &text, const std::string &needle) {
+        size_t n = 0;
+        for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + needle.size())) n++;
+        return n;
+    }
+    // 每个测试自己的临时目录下的文件名
+    inline std::string tempPath(const std::string &name) {
+        return "/tmp/log_test_" + std::to_string(getpid()) + "_" + name;
+    }
+}
@@ -0,0 +1,223 @@
+// coro_test.cpp - 协程接口（logs/coro.hpp），需要 C++20
+// 单线程执行器上跑几个写日志的协程和一个心跳协程。落地方向扣住第一批，直到生产缓冲区写满：
+//   co_await logAsync 在缓冲区满时挂起，执行器不被阻塞：挂起期间心跳照常运行，之后才放行；
+//   工作线程交换缓冲区后协程恢复，每条日志按顺序送达，co_await flushAsync 恢复时此前的日志都已落地。
+// 同样的负载用阻塞接口再跑一遍作为对照：扣住第一批时执行器线程卡在 logAt 里，心跳一次也不会运行。
+// 只按事件计数判断，不比较耗时，机器负载高时结果不变。
+
+#include "../logs/coro.hpp"
+#include "check.hpp"
+#include <deque>
+#include <thread>
+
+using namespace MySpace;
+
+// 单线程执行器：post 可以在任意线程调用，run 在当前线程依次恢复协程，直到所有任务结束
+class Executor {
+    public:
+        void post(std::coroutine_handle<> h) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            // 从执行器之外的线程投递：日志器工作线程唤醒挂起的协程
+            if (std::this_thread::get_id() != _owner) _remote_posts++;
+            _ready.push_back(h);
+            _cond.notify_one();
+        }
+        void started() { ++_live; }
+        void finished() { --_live; }
+        void run() {
+            _owner = std::this_thread::get_id();
+            while (true) {
+                std::coroutine_handle<> h;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _cond.wait(lock, [&]() { return !_ready.empty() || _live == 0; });
+                    if (_ready.empty()) return;
+                    h = _ready.front();
+                    _ready.pop_front();
+                }
+                h.resume();
+            }
+        }
+        size_t remotePosts() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            return _remote_posts;
+        }
+    private:
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::deque<std::coroutine_handle<>> _ready;
+        std::atomic<size_t> _live{0};
+        std::thread::id _owner;
+        size_t _remote_posts = 0;
+};
+
+// 即发即忘的任务：创建后挂起，由执行器第一次恢复
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> handle;
+};
+
+static void spawn(Executor &exec, Task task) {
+    exec.started();
+    exec.post(task.handle);
+}
+
+struct Yield {
+    Executor &exec;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { exec.post(h); }
+    void await_resume() const noexcept {}
+};
+
+// 按 "生产者编号 序号 ..." 记录每个生产者收到的条数并检查顺序；第一批交给 gate，gate 返回前工作线程停在这里
+class GatedSink : public LogSink {
+    public:
+        GatedSink(size_t producers, std::function<void(size_t)> gate) : _received(producers, 0), _gate(gate) {}
+        void log(const char *data, size_t len) override {
+            std::unique_lock<std::mutex> lock(_mutex);
+            Simd::forEachLine(data, len, [&](const char *line, size_t) {
+                char *end = nullptr;
+                size_t producer = strtoul(line, &end, 10);
+                size_t seq = strtoul(end, nullptr, 10);
+                if (producer >= _received.size() || seq != _received[producer]) _out_of_order = true;
+                else _received[producer]++;
+            });
+        }
+        void logRecords(Buffer &buf, LogLevel::value min_level) override {
+            if (_gate) {
+                _gate(buf.readAbleSize());
+                _gate = nullptr;
+            }
+            LogSink::logRecords(buf, min_level);
+        }
+        size_t received(size_t producer) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            return _received[producer];
+        }
+        bool outOfOrder() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            return _out_of_order;
+        }
+    private:
+        std::mutex _mutex;
+        std::vector<size_t> _received;
+        bool _out_of_order = false;
+        std::function<void(size_t)> _gate;      // 只在工作线程中使用
+};
+
+struct Run {
+    Executor exec;
+    std::shared_ptr<GatedSink> sink;
+    std::shared_ptr<Logger> logger;
+    size_t remaining = 0;
+    bool done = false;
+    std::atomic<size_t> heartbeats{0};      // 工作线程中的 gate 也会读取
+    std::atomic<size_t> attempted{0};       // 已经开始写入的字节数（在调用 logAt/logAsync 之前累加）
+    std::atomic<bool> gate_opened{false};   // gate 的条件成立过（缓冲区确实写满了）
+    size_t blocked_heartbeats = 0;          // 阻塞接口：扣住第一批期间心跳运行的次数
+    size_t progressed = 0;                  // 写一条日志的过程中心跳运行过的次数（挂起期间执行器照常运行）
+    std::vector<bool> flushed;              // 各生产者 flushAsync 恢复时此前的日志是否都已落地
+};
+
+static Task producer(Run &run, size_t id, size_t count, bool await) {
+    std::string payload(1000, 'x');
+    for (size_t i = 0; i < count; ++i) {
+        std::string msg = std::to_string(id) + " " + std::to_string(i) + " " + payload;
+        run.attempted += msg.size() + 1;
+        size_t before = run.heartbeats;
+        if (await) co_await logAsync(*run.logger, run.exec, LogLevel::INFO, __FILE__, __LINE__, msg);
+        else run.logger->logAt(LogLevel::INFO, __FILE__, __LINE__, msg);
+        if (run.heartbeats != before) run.progressed++;
+        if (i % 64 == 63) co_await Yield{run.exec};
+    }
+    co_await flushAsync(*run.logger, run.exec);
+    run.flushed[id] = run.sink->received(id) == count;
+    run.remaining--;
+    run.exec.finished();
+}
+
+static Task heartbeat(Run &run) {
+    while (!run.done) {
+        co_await Yield{run.exec};
+        run.heartbeats++;
+    }
+    run.exec.finished();
+}
+
+static Task waiter(Run &run) {
+    while (run.remaining > 0) co_await Yield{run.exec};
+    run.done = true;
+    run.exec.finished();
+}
+
+static void waitUntil(const std::function<bool()> &cond) {
+    while (!cond()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+/* 第一批的 gate（在工作线程中运行）：
+   await   ：等到有协程挂起（tryLog 失败时立即计入 producer_waits），再等心跳运行若干次才放行
+   blocking：开始写入的字节超过第一批加整个生产缓冲区时，正在写的那条一定放不下，执行器线程阻塞在 logAt 里；
+             此时再看一段时间，心跳不应运行 */
+static void gate(Run &run, bool await, size_t batch) {
+    if (await) {
+        waitUntil([&]() { return run.logger->stats().producer_waits > 0; });
+        size_t heartbeats = run.heartbeats;
+        waitUntil([&]() { return run.heartbeats >= heartbeats + 10; });
+    } else {
+        waitUntil([&]() { return run.attempted > batch + DEFAULT_BUFFER_SIZE; });
+        size_t heartbeats = run.heartbeats;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        run.blocked_heartbeats = run.heartbeats - heartbeats;
+    }
+    run.gate_opened = true;
+}
+
+static void runOnce(Run &run, size_t producers, size_t count, bool await) {
+    run.sink = std::make_shared<GatedSink>(producers, [&run, await](size_t batch) { gate(run, await, batch); });
+    run.logger = LoggerFactory::createAsynchLogger(await ? "coro-await" : "coro-blocking", LogLevel::DEBUG, "%m%n", {run.sink});
+    run.remaining = producers;
+    run.flushed.assign(producers, false);
+    for (size_t i = 0; i < producers; ++i) spawn(run.exec, producer(run, i, count, await));
+    spawn(run.exec, heartbeat(run));
+    spawn(run.exec, waiter(run));
+    run.exec.run();
+}
+
+int main() {
+    // 卡住时由 SIGALRM 结束进程，不依赖 ctest 的超时
+    alarm(60);
+    const size_t producers = 4, count = 3000;     // 共约 12M，生产缓冲区 1M
+
+    Run await;
+    runOnce(await, producers, count, true);
+    CHECK(await.remaining == 0);
+    CHECK(await.gate_opened);
+    // 缓冲区满时挂起，由工作线程交换缓冲区后投递回执行器恢复
+    CHECK(await.exec.remotePosts() > 0);
+    // 挂起期间执行器照常运行其他协程
+    CHECK(await.progressed > 0);
+    // 每条日志按顺序送达；flushAsync 恢复时该生产者的日志都已落地
+    CHECK(!await.sink->outOfOrder());
+    for (size_t i = 0; i < producers; ++i) {
+        CHECK(await.sink->received(i) == count);
+        CHECK(await.flushed[i]);
+    }
+
+    // 对照：阻塞接口在缓冲区满时卡住整个执行器线程，写日志的过程中心跳从不运行
+    Run blocking;
+    runOnce(blocking, producers, count, false);
+    CHECK(blocking.gate_opened);
+    CHECK(blocking.blocked_heartbeats == 0);
+    CHECK(blocking.progressed == 0);
+    CHECK(!blocking.sink->outOfOrder());
+    for (size_t i = 0; i < producers; ++i) CHECK(blocking.sink->received(i) == count);
+    printf("coro_test: ok (await: %zu writes overlapped heartbeats, %zu remote resumes)\n", await.progressed,
+        await.exec.remotePosts());
+    return 0;
+}
@@ -0,0 +1,55 @@
+// exit_order_test.cpp - 进程退出时的有序关闭（LoggerManager::shutdown 经 atexit 调用）
+// 先用 LoggerManager 再用 SinkRegistry 时，SinkRegistry 曾在 atexit 回调之前析构，
+// shutdown 访问已释放的注册表（ASan 下报 heap-use-after-free）。子进程中复现这个顺序并正常退出，
+// 检查退出码和日志是否完整落地。
+
+#include "../logs/logger.hpp"
+#include "check.hpp"
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace MySpace;
+
+// 在子进程中执行 scenario 后 exit(0)，返回子进程的退出状态
+template<class F>
+static int runChild(F &&scenario) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        scenario();
+        exit(0);    // 走 atexit：LoggerManager::shutdownAtExit 和静态对象析构
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return status;
+}
+
+int main() {
+    // 1、 先用 LoggerManager，再第一次用 SinkRegistry
+    std::string path = LogTest::tempPath("exit_order.log");
+    unlink(path.c_str());
+    int status = runChild([&]() {
+        LoggerManager::getInstance().rootLogger();
+        auto sink = SinkRegistry::getInstance().file(path);
+        auto logger = LoggerFactory::createAsynchLogger("exit", LogLevel::INFO, "%m%n", {sink});
+        LoggerManager::getInstance().addLogger(logger);
+        for (int i = 0; i < 1000; ++i) logger->info(__FILE__, __LINE__, "line " + std::to_string(i));
+    });
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    std::string text = LogTest::readFile(path);
+    CHECK(LogTest::countOf(text, "line ") == 1000);
+    CHECK(text.find("line 999\n") != std::string::npos);
+    unlink(path.c_str());
+
+    // 2、 反过来：先用 SinkRegistry，再用 LoggerManager
+    status = runChild([&]() {
+        auto sink = SinkRegistry::getInstance().file(path);
+        auto logger = LoggerFactory::createAsynchLogger("exit", LogLevel::INFO, "%m%n", {sink});
+        LoggerManager::getInstance().addLogger(logger);
+        for (int i = 0; i < 1000; ++i) logger->info(__FILE__, __LINE__, "line " + std::to_string(i));
+    });
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(LogTest::countOf(LogTest::readFile(path), "line ") == 1000);
+    unlink(path.c_str());
+    printf("exit_order_test: ok\n");
+    return 0;
+}
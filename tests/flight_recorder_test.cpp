@@ -0,0 +1,162 @@
+// flight_recorder_test.cpp - 飞行记录器（FlightRecorderSink）
+//   低于等级阈值的日志只做二进制编码，不在调用线程中格式化；dump 时用记录器的格式输出；
+//   多线程并发写入并绕回时，dump 出的每条日志都是完整的，同一线程的日志保持顺序；
+//   达到触发等级时由 dump 线程输出，记录日志的线程只做通知，flush() 等待 dump 完成；
+//   崩溃时在信号处理函数中输出编码的日志。
+
+#include "../logs/logger.hpp"
+#include "check.hpp"
+#include <dirent.h>
+#include <sys/wait.h>
+#include <thread>
+
+using namespace MySpace;
+
+// 同步日志器：DEBUG 不落地，只进飞行记录器；ERROR 触发 dump
+static void testNoFormatBelowThreshold() {
+    std::string dump_path = LogTest::tempPath("recorder_threshold.dump");
+    std::string file_path = LogTest::tempPath("recorder_threshold.log");
+    auto recorder = std::make_shared<FlightRecorderSink>(dump_path, 64 * 1024, LogLevel::ERROR
+        , std::make_shared<Formatter>("%p %m%n"));
+    auto logger = LoggerFactory::createSynchLogger("recorder-threshold", LogLevel::ERROR, "%m%n"
+        , {std::make_shared<FileSink>(file_path)});
+    logger->setFlightRecorder(recorder);
+    for (int i = 0; i < 100; ++i) logger->debug(__FILE__, __LINE__, "d" + std::to_string(i));
+    LoggerStatsSnapshot s = logger->stats();
+    CHECK(s.filtered == 100);
+    CHECK(s.bytes_formatted == 0);
+    CHECK(LogTest::readFile(dump_path).empty());
+
+    logger->error(__FILE__, __LINE__, "boom");
+    logger->flush();
+    std::string dump = LogTest::readFile(dump_path);
+    CHECK(dump.find("DEBUG d0\n") != std::string::npos);
+    CHECK(dump.find("DEBUG d99\n") != std::string::npos);
+    CHECK(dump.find("ERROR boom\n") != std::string::npos);
+    CHECK(LogTest::readFile(file_path) == "boom\n");
+
+    // 已经 dump 过的不再重复输出
+    recorder->dump();
+    CHECK(LogTest::countOf(LogTest::readFile(dump_path), "DEBUG d0\n") == 1);
+    unlink(dump_path.c_str());
+    unlink(file_path.c_str());
+}
+
+static size_t threadCount() {
+    size_t n = 0;
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) return 0;
+    while (struct dirent *e = readdir(dir))
+        if (e->d_name[0] != '.') n++;
+    closedir(dir);
+    return n;
+}
+
+// 触发 dump 的是 dump 线程（第一次触发时启动，之后复用）；多个线程同时触发时每条日志都会被 dump 出来且只出现一次
+static void testDumpThread() {
+    std::string dump_path = LogTest::tempPath("recorder_thread.dump");
+    const size_t threads = 4, count = 50;
+    {
+        FlightRecorderSink recorder(dump_path, 1024 * 1024, LogLevel::ERROR);
+        size_t before = threadCount();
+        recorder.record(LogLevel::ERROR, "first\n", 6);
+        CHECK(threadCount() == before + 1);
+        recorder.flush();
+        CHECK(LogTest::readFile(dump_path).find("first\n") != std::string::npos);
+
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                for (size_t i = 0; i < count; ++i) {
+                    std::string line = "e " + std::to_string(t) + " " + std::to_string(i) + "\n";
+                    recorder.record(LogLevel::ERROR, line.data(), line.size());
+                }
+            });
+        }
+        for (auto &w : workers) w.join();
+        CHECK(threadCount() == before + 1);
+        recorder.flush();
+        std::string dump = LogTest::readFile(dump_path);
+        for (size_t t = 0; t < threads; ++t)
+            for (size_t i = 0; i < count; ++i)
+                CHECK(LogTest::countOf(dump, "e " + std::to_string(t) + " " + std::to_string(i) + "\n") == 1);
+        // 析构时做完最后一次触发的 dump
+        recorder.record(LogLevel::ERROR, "last\n", 5);
+    }
+    CHECK(LogTest::readFile(dump_path).find("last\n") != std::string::npos);
+    unlink(dump_path.c_str());
+}
+
+// 多线程写入长短不一的日志（跨多个槽位），环形内存远小于写入量
+static void testConcurrentWrap() {
+    std::string dump_path = LogTest::tempPath("recorder_wrap.dump");
+    const size_t threads = 8, count = 5000;
+    FlightRecorderSink recorder(dump_path, 64 * 1024, LogLevel::OFF);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (size_t i = 0; i < count; ++i) {
+                // "线程 序号 长度 负载\n"，负载长度 0~999，由序号决定
+                size_t len = (i * 37 + t * 101) % 1000;
+                std::string line = std::to_string(t) + " " + std::to_string(i) + " " + std::to_string(len) + " "
+                    + std::string(len, (char)('a' + t)) + "\n";
+                recorder.record(LogLevel::INFO, line.data(), line.size());
+            }
+        });
+    }
+    for (auto &w : workers) w.join();
+    recorder.dump();
+
+    std::string dump = LogTest::readFile(dump_path);
+    std::istringstream in(dump);
+    std::string line;
+    std::vector<long> last(threads, -1);
+    size_t lines = 0;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 8, "========") == 0) continue;
+        size_t t = 0, i = 0, len = 0;
+        int used = 0;
+        CHECK(sscanf(line.c_str(), "%zu %zu %zu %n", &t, &i, &len, &used) == 3);
+        CHECK(t < threads && i < count);
+        CHECK(line.size() - used == len);
+        CHECK(line.find_first_not_of((char)('a' + t), used) == std::string::npos);
+        CHECK((long)i > last[t]);
+        last[t] = i;
+        lines++;
+    }
+    // 64K 的环形内存里应该留下最近的几十条
+    CHECK(lines > 20);
+    unlink(dump_path.c_str());
+}
+
+// 崩溃时在信号处理函数中 dump：编码的日志不经过格式化器，按固定格式输出
+static void testCrashDump() {
+    std::string dump_path = LogTest::tempPath("recorder_crash.dump");
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        CrashHandler::install();
+        auto recorder = std::make_shared<FlightRecorderSink>(dump_path, 64 * 1024, LogLevel::FATAL);
+        auto logger = LoggerFactory::createSynchLogger("recorder-crash", LogLevel::OFF, "%m%n", {});
+        logger->setFlightRecorder(recorder);
+        logger->info("crash.cpp", 42, "before crash");
+        raise(SIGSEGV);
+        std::_Exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+    std::string dump = LogTest::readFile(dump_path);
+    CHECK(dump.find("][recorder-crash][crash.cpp:42][INFO] before crash\n") != std::string::npos);
+    unlink(dump_path.c_str());
+}
+
+int main() {
+    alarm(60);
+    testNoFormatBelowThreshold();
+    testConcurrentWrap();
+    testDumpThread();
+    testCrashDump();
+    printf("flight_recorder_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,47 @@
+// format_test.cpp - 结构化格式（JSON / logfmt / %F）中字段键的转义与内置键冲突
+
+#include "../logs/format.hpp"
+#include "check.hpp"
+
+using namespace MySpace;
+
+static std::string formatWith(Formatter &fmt, std::vector<LogField> fields) {
+    LogMsg msg(LogLevel::INFO, 7, "format_test.cpp", "fmt", "hello");
+    msg._fields = std::move(fields);
+    return fmt.format(msg);
+}
+
+int main() {
+    Formatter json(FORMAT_JSON);
+    Formatter logfmt(FORMAT_LOGFMT);
+    Formatter pattern("%m%F%n");
+
+    // 键里的引号、反斜杠、控制字符按 JSON 规则转义，整行仍是一个对象
+    std::string out = formatWith(json, {{"a\"b", 1}, {"c\\d", 2}, {"e\nf", 3}});
+    CHECK(out.find(",\"a\\\"b\":1") != std::string::npos);
+    CHECK(out.find(",\"c\\\\d\":2") != std::string::npos);
+    CHECK(out.find(",\"e\\nf\":3") != std::string::npos);
+    CHECK(LogTest::countOf(out, "\n") == 1);
+
+    // logfmt：含空格或 = 的键加引号
+    out = formatWith(logfmt, {{"user id", 42}, {"a=b", true}, {"plain", "v"}});
+    CHECK(out.find(" \"user id\"=42") != std::string::npos);
+    CHECK(out.find(" \"a=b\"=true") != std::string::npos);
+    CHECK(out.find(" plain=v") != std::string::npos);
+    out = formatWith(pattern, {{"x y", 1}});
+    CHECK(out == "hello \"x y\"=1\n");
+
+    // 和内置键重名的字段改名，不覆盖日志本身的消息、等级
+    out = formatWith(json, {{"msg", "spoofed"}, {"level", "FATAL"}, {"user", 1}});
+    CHECK(LogTest::countOf(out, "\"msg\":") == 1);
+    CHECK(out.find("\"msg\":\"hello\"") != std::string::npos);
+    CHECK(out.find(",\"fields.msg\":\"spoofed\"") != std::string::npos);
+    CHECK(LogTest::countOf(out, "\"level\":") == 1);
+    CHECK(out.find(",\"fields.level\":\"FATAL\"") != std::string::npos);
+    CHECK(out.find(",\"user\":1}") != std::string::npos);
+    out = formatWith(logfmt, {{"time", 1}, {"msg", "x"}});
+    CHECK(LogTest::countOf(out, " msg=") == 1 && out.compare(0, 5, "time=") == 0 && LogTest::countOf(out, " time=") == 0);
+    CHECK(out.find(" fields.time=1 fields.msg=x\n") != std::string::npos);
+    printf("format_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+// limiter_test.cpp - 调用点限流与去重（RateLimiter / Deduplicator / LOG_RATE_LIMIT / LOG_DEDUP）
+//   令牌桶的突发量和补充、被丢弃条数的汇总；不合法的速率不会产生未定义行为；
+//   开始丢弃后汇总行在日志器 flush 时输出，且只输出一次。
+
+#include "../logs/logger.hpp"
+#include "check.hpp"
+#include <cmath>
+
+using namespace MySpace;
+
+class LinesSink : public LogSink {
+    public:
+        void log(const char *data, size_t len) override { _text.append(data, len); }
+        const std::string &text() const { return _text; }
+    private:
+        std::string _text;
+};
+
+// 每秒 10 条（100ms 一个令牌），突发 5 条
+static void testRateLimiter() {
+    RateLimiter limiter(10, 5);
+    uint64_t dropped = 0;
+    for (int i = 0; i < 5; ++i) {
+        CHECK(limiter.allow(dropped));
+        CHECK(dropped == 0);
+    }
+    for (uint64_t i = 1; i <= 3; ++i) {
+        CHECK(!limiter.allow(dropped));
+        CHECK(dropped == i);
+    }
+    usleep(150 * 1000);
+    CHECK(limiter.allow(dropped));
+    CHECK(dropped == 3);
+    CHECK(limiter.takeSummary().empty());
+}
+
+// 不是正数的速率按每小时 1 条：只放行突发量；无穷大不限流
+static void testInvalidRate() {
+    for (double rate : {0.0, -1.0, std::nan("")}) {
+        RateLimiter limiter(rate, 2);
+        uint64_t dropped = 0;
+        CHECK(limiter.allow(dropped) && limiter.allow(dropped));
+        CHECK(!limiter.allow(dropped));
+        CHECK(limiter.takeSummary() == RateLimiter::summary(1));
+    }
+    RateLimiter unlimited(INFINITY, 1);
+    uint64_t dropped = 0;
+    for (int i = 0; i < 1000; ++i) CHECK(unlimited.allow(dropped));
+}
+
+static void testDeduplicator() {
+    Deduplicator dedup(60000);
+    uint64_t repeats = 0;
+    CHECK(dedup.allow("a", repeats) && repeats == 0);
+    for (uint64_t i = 1; i <= 3; ++i) {
+        CHECK(!dedup.allow("a", repeats));
+        CHECK(repeats == i);
+    }
+    CHECK(dedup.allow("b", repeats) && repeats == 3);
+    CHECK(!dedup.allow("b", repeats));
+    CHECK(dedup.takeSummary() == Deduplicator::summary(1));
+    CHECK(dedup.takeSummary().empty());
+}
+
+// 宏：丢弃的条数在 flush 时汇总输出一次（调用点的状态是 static 的，同步/异步各用一个模板实例）
+template <bool asynch>
+static void testMacros() {
+    auto sink = std::make_shared<LinesSink>();
+    std::string name = asynch ? "limiter-asynch" : "limiter-synch";
+    auto logger = asynch
+        ? LoggerFactory::createAsynchLogger(name, LogLevel::DEBUG, "%m%n", {sink})
+        : LoggerFactory::createSynchLogger(name, LogLevel::DEBUG, "%m%n", {sink});
+    for (int i = 0; i < 10; ++i) LOG_RATE_LIMIT(logger, LogLevel::INFO, 0.001, 3, "limited " + std::to_string(i));
+    for (int i = 0; i < 10; ++i) LOG_DEDUP(logger, LogLevel::WARN, 60000, std::string("same"));
+    CHECK(logger->flush());
+    CHECK(sink->text() == "limited 0\nlimited 1\nlimited 2\nsame\n"
+        "7 messages suppressed by rate limit\nlast message repeated 9 times\n");
+    CHECK(logger->flush());
+    CHECK(LogTest::countOf(sink->text(), "suppressed") == 1);
+    CHECK(LogTest::countOf(sink->text(), "repeated") == 1);
+    // 不同内容到来时不再重复输出已汇总的次数
+    LOG_DEDUP(logger, LogLevel::WARN, 60000, std::string("other"));
+    CHECK(logger->flush());
+    CHECK(LogTest::countOf(sink->text(), "repeated") == 1);
+}
+
+int main() {
+    alarm(60);
+    testRateLimiter();
+    testInvalidRate();
+    testDeduplicator();
+    testMacros<false>();
+    testMacros<true>();
+    printf("limiter_test: ok\n");
+    return 0;
+}
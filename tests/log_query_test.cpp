@@ -0,0 +1,143 @@
+// log_query_test.cpp - 日志查询工具（tools/log_query），参数为 log_query 可执行文件的路径
+//   等级按记录中 %p 的位置判断，消息正文里的等级名不算；
+//   时间逐行判断：有索引的文件中与查询范围相交的段、索引之后的尾部、没有索引的文件都只输出范围内的行；
+//   时间格式里没有日期时取文件修改时间的日期。
+
+#include "../logs/index.hpp"
+#include "check.hpp"
+#include <ctime>
+#include <sys/time.h>
+
+using namespace MySpace;
+
+static std::string g_tool;
+
+// 运行 log_query，返回标准输出
+static std::string query(const std::string &args) {
+    std::string cmd = g_tool + " " + args + " 2>/dev/null";
+    FILE *p = popen(cmd.c_str(), "r");
+    CHECK(p != nullptr);
+    std::string out;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), p)) > 0) out.append(buf, n);
+    CHECK(pclose(p) == 0);
+    return out;
+}
+
+static time_t localTime(int hour, int min, int sec) {
+    struct tm t;
+    memset(&t, 0, sizeof(t));
+    t.tm_year = 2026 - 1900;
+    t.tm_mon = 9;
+    t.tm_mday = 19;
+    t.tm_hour = hour;
+    t.tm_min = min;
+    t.tm_sec = sec;
+    t.tm_isdst = -1;
+    return mktime(&t);
+}
+
+static std::string line(const char *fmt, time_t secs, const char *level, const std::string &msg) {
+    struct tm t;
+    localtime_r(&secs, &t);
+    char stamp[64];
+    strftime(stamp, sizeof(stamp), fmt, &t);
+    return "[" + std::string(stamp) + "][" + level + "] " + msg + "\n";
+}
+
+static void writeFile(const std::string &path, const std::string &text) {
+    FILE *f = fopen(path.c_str(), "w");
+    CHECK(f != nullptr);
+    fwrite(text.data(), 1, text.size(), f);
+    fclose(f);
+}
+
+static const char *PATTERN = "--pattern '[%d{%Y-%m-%d %H:%M:%S}][%p] %m%n'";
+static const char *DATE_FMT = "%Y-%m-%d %H:%M:%S";
+
+// 正文里出现 ERROR 的 INFO 行不能通过 --level ERROR
+static void testLevelPosition() {
+    std::string path = LogTest::tempPath("query_level.log");
+    std::string text = line(DATE_FMT, localTime(10, 0, 0), "INFO", "upstream returned ERROR 502")
+        + line(DATE_FMT, localTime(10, 0, 1), "ERROR", "real failure")
+        + line(DATE_FMT, localTime(10, 0, 2), "WARN", "FATAL mentioned")
+        + line(DATE_FMT, localTime(10, 0, 3), "FATAL", "crash");
+    writeFile(path, text);
+    std::string out = query(std::string(PATTERN) + " --level ERROR " + path);
+    CHECK(out == line(DATE_FMT, localTime(10, 0, 1), "ERROR", "real failure") + line(DATE_FMT, localTime(10, 0, 3), "FATAL", "crash"));
+    CHECK(query(std::string(PATTERN) + " --level ERROR --count " + path) == "2\n");
+    unlink(path.c_str());
+}
+
+// 有索引的文件：两段各 5 秒，查询范围跨两段，另有索引之后的尾部
+static void testTimeIndexed() {
+    std::string path = LogTest::tempPath("query_indexed.log");
+    std::string text;
+    {
+        IndexWriter index(5 * 64);
+        CHECK(index.open(path, 0));
+        for (int s = 0; s < 10; ++s) {
+            std::string l = line(DATE_FMT, localTime(10, 0, s), "INFO", "tick " + std::to_string(s) + " " + std::string(60, '.'));
+            l.resize(64 - 1);
+            l.push_back('\n');
+            text += l;
+            index.add((uint64_t)localTime(10, 0, s) * 1000000000ull, LogLevel::INFO, l.size());
+        }
+    }
+    // 尾部不在索引中
+    text += line(DATE_FMT, localTime(10, 0, 20), "INFO", "tail");
+    writeFile(path, text);
+    std::vector<IndexEntry> entries;
+    CHECK(IndexWriter::read(path, entries) && entries.size() == 2);
+    std::string out = query(std::string(PATTERN) + " --from '2026-10-19 10:00:03' --to '2026-10-19 10:00:06' " + path);
+    CHECK(LogTest::countOf(out, "\n") == 4);
+    for (int s = 3; s <= 6; ++s) CHECK(out.find("tick " + std::to_string(s)) != std::string::npos);
+    CHECK(out.find("tick 2") == std::string::npos && out.find("tick 7") == std::string::npos);
+    CHECK(out.find("tail") == std::string::npos);
+    CHECK(query(std::string(PATTERN) + " --from '2026-10-19 10:00:20' " + path).find("tail") != std::string::npos);
+    unlink(path.c_str());
+    unlink((path + ".idx").c_str());
+}
+
+// 没有索引、时间格式只有时分秒（默认格式）：日期取文件修改时间
+static void testTimeWithoutDate() {
+    std::string path = LogTest::tempPath("query_nodate.log");
+    std::string text;
+    for (int s = 0; s < 10; ++s)
+        text += "[10:00:0" + std::to_string(s) + "][1][app][main.cpp:1][INFO]\tmsg " + std::to_string(s) + "\n";
+    writeFile(path, text);
+    struct timeval times[2];
+    times[0].tv_sec = times[1].tv_sec = localTime(23, 0, 0);
+    times[0].tv_usec = times[1].tv_usec = 0;
+    CHECK(utimes(path.c_str(), times) == 0);
+    std::string out = query("--from '2026-10-19 10:00:02' --to '2026-10-19 10:00:04' --level INFO " + path);
+    CHECK(out == "[10:00:02][1][app][main.cpp:1][INFO]\tmsg 2\n[10:00:03][1][app][main.cpp:1][INFO]\tmsg 3\n"
+        "[10:00:04][1][app][main.cpp:1][INFO]\tmsg 4\n");
+    // 别的日期查不到
+    CHECK(query("--from '2026-10-18 10:00:02' --to '2026-10-18 10:00:04' " + path).empty());
+    unlink(path.c_str());
+}
+
+// logfmt：time 和 level 是固定的前两个字段，正文里的 level=ERROR 不算
+static void testLogfmt() {
+    std::string path = LogTest::tempPath("query_logfmt.log");
+    writeFile(path, "time=2026-10-19T10:00:00 level=INFO logger=app msg=\"level=ERROR in text\"\n"
+                    "time=2026-10-19T10:00:01 level=ERROR logger=app msg=failed\n");
+    CHECK(query("--format logfmt --level ERROR " + path) == "time=2026-10-19T10:00:01 level=ERROR logger=app msg=failed\n");
+    CHECK(query("--format logfmt --to '2026-10-19 10:00:00' " + path)
+        == "time=2026-10-19T10:00:00 level=INFO logger=app msg=\"level=ERROR in text\"\n");
+    unlink(path.c_str());
+}
+
+int main(int argc, char *argv[]) {
+    CHECK(argc > 1);
+    g_tool = argv[1];
+    alarm(60);
+    testLevelPosition();
+    testTimeIndexed();
+    testTimeWithoutDate();
+    testLogfmt();
+    printf("log_query_test: ok\n");
+    return 0;
+}
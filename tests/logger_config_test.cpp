@@ -0,0 +1,115 @@
+// logger_config_test.cpp - 运行时替换格式化器、落地方向和飞行记录器（Logger::setFormatter / setSinks / setFlightRecorder）
+//   多个线程持续记录日志时反复替换，被替换下来的对象在读者退出后被回收（不会一直留到日志器析构），
+//   回收时没有线程还在使用它们（用 AddressSanitizer 构建时检查释放后使用），每条日志都完整地写到某个落地方向。
+
+#include "../logs/logger.hpp"
+#include "check.hpp"
+#include <thread>
+
+using namespace MySpace;
+
+// 检查每行都是某个格式化器产生的 "F<编号>:w<线程> <序号>"；计数放在测试持有的 Counts 里，落地方向本身只由日志器持有
+struct Counts {
+    std::mutex mutex;
+    size_t lines = 0;
+    size_t bad = 0;
+};
+
+class CheckingSink : public LogSink {
+    public:
+        explicit CheckingSink(std::shared_ptr<Counts> counts) : _counts(counts) {}
+        void log(const char *data, size_t len) override {
+            std::unique_lock<std::mutex> lock(_counts->mutex);
+            Simd::forEachLine(data, len, [&](const char *line, size_t n) {
+                std::string text(line, n);
+                if (text.size() < 4 || text[0] != 'F' || text.find(":w") == std::string::npos) _counts->bad++;
+                _counts->lines++;
+            });
+        }
+    private:
+        std::shared_ptr<Counts> _counts;
+};
+
+static void run(bool asynch) {
+    const size_t threads = 4, swaps = 300;
+    std::vector<std::shared_ptr<Counts>> counts;
+    std::vector<std::weak_ptr<Formatter>> old_formatters;
+    std::vector<std::weak_ptr<LogSink>> old_sinks;
+    std::vector<std::weak_ptr<FlightRecorderSink>> old_recorders;
+    std::string dump_path = LogTest::tempPath(asynch ? "config_asynch.dump" : "config_synch.dump");
+    counts.push_back(std::make_shared<Counts>());
+    auto first = std::make_shared<CheckingSink>(counts.back());
+    old_sinks.push_back(first);
+    auto logger = asynch
+        ? LoggerFactory::createAsynchLogger("config-asynch", LogLevel::DEBUG, "F0:%m%n", {first})
+        : LoggerFactory::createSynchLogger("config-synch", LogLevel::DEBUG, "F0:%m%n", {first});
+    first.reset();
+
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> written(0);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (size_t i = 0; !stop.load(); ++i) {
+                logger->info(__FILE__, __LINE__, "w" + std::to_string(t) + " " + std::to_string(i));
+                written++;
+            }
+        });
+    }
+    for (size_t i = 1; i <= swaps; ++i) {
+        // 每次替换之间让记录日志的线程写上一些
+        while (written.load() < i * 20) std::this_thread::yield();
+        auto formatter = std::make_shared<Formatter>("F" + std::to_string(i) + ":%m%n");
+        old_formatters.push_back(formatter);
+        logger->setFormatter(formatter);
+        if (i % 10 == 0) {
+            // 旧的落地方向只由日志器持有，回收后随之析构
+            counts.push_back(std::make_shared<Counts>());
+            auto sink = std::make_shared<CheckingSink>(counts.back());
+            old_sinks.push_back(sink);
+            logger->setSinks({sink});
+        }
+        if (i % 25 == 0) {
+            // 交替挂上新的记录器和摘掉记录器
+            std::shared_ptr<FlightRecorderSink> recorder;
+            if (i % 50 == 0) recorder = std::make_shared<FlightRecorderSink>(dump_path, 64 * 1024, LogLevel::OFF);
+            old_recorders.push_back(recorder);
+            logger->setFlightRecorder(recorder);
+        }
+    }
+    stop = true;
+    for (auto &w : workers) w.join();
+    CHECK(logger->flush());
+    CHECK(logger->flush());
+
+    // 除了当前的格式化器和落地方向，其余都已经释放
+    size_t alive = 0;
+    for (auto &f : old_formatters) alive += !f.expired();
+    CHECK(alive == 1);
+    CHECK(old_formatters.back().lock().get() == &logger->formatter());
+    alive = 0;
+    for (auto &sink : old_sinks) alive += !sink.expired();
+    CHECK(alive == 1);
+    CHECK(old_sinks.back().lock() == logger->sinks()[0]);
+    alive = 0;
+    for (auto &recorder : old_recorders) alive += !recorder.expired();
+    CHECK(alive == (old_recorders.back().expired() ? 0u : 1u));
+    logger->setFlightRecorder(nullptr);
+    unlink(dump_path.c_str());
+
+    size_t lines = 0;
+    for (auto &c : counts) {
+        CHECK(c->bad == 0);
+        lines += c->lines;
+    }
+    CHECK(lines == written.load());
+    printf("%s: %zu lines, %zu swaps\n", asynch ? "asynch" : "synch", lines, swaps);
+}
+
+int main() {
+    alarm(60);
+    run(false);
+    run(true);
+    printf("logger_config_test: ok\n");
+    return 0;
+}
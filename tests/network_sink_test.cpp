@@ -0,0 +1,384 @@
+// network_sink_test.cpp - NetworkSink 在本机回环上的收发：
+// UDP/TCP 分帧与整批发送、超大数据报、退避重连、暂存文件补发（至少一次）、每次调用的阻塞上限
+
+#include "../logs/logger.hpp"
+#include "check.hpp"
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace MySpace;
+
+static uint64_t nowMs() { return StatsClock::nowNs() / 1000000; }
+
+// 绑定 127.0.0.1 上的端口（0 为随机），返回端口号
+static uint16_t bindLoopback(int fd, uint16_t port = 0) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    CHECK(::bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0);
+    socklen_t len = sizeof(addr);
+    CHECK(getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &len) == 0);
+    return ntohs(addr.sin_port);
+}
+
+static bool waitReadable(int fd, int timeout_ms) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    return ::poll(&pfd, 1, timeout_ms) > 0;
+}
+
+// UDP 收集端：收到的每个数据报一条
+struct UdpServer {
+    int fd;
+    uint16_t port;
+    explicit UdpServer(uint16_t bind_port = 0) {
+        fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        int size = 8 * 1024 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        port = bindLoopback(fd, bind_port);
+    }
+    ~UdpServer() { ::close(fd); }
+    std::vector<std::string> receive(size_t count, int timeout_ms = 2000) {
+        std::vector<std::string> out;
+        std::vector<char> buf(70000);
+        while (out.size() < count && waitReadable(fd, timeout_ms)) {
+            ssize_t n = ::recv(fd, buf.data(), buf.size(), 0);
+            if (n >= 0) out.emplace_back(buf.data(), n);
+        }
+        return out;
+    }
+};
+
+// TCP 收集端：按协议拆帧；listen 之前连接会被拒绝
+struct TcpServer {
+    int listen_fd;
+    int conn_fd = -1;
+    uint16_t port;
+    std::string pending;
+    explicit TcpServer(int rcvbuf = 0) {
+        listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        // 接受的连接继承监听套接字的接收缓冲区大小
+        if (rcvbuf > 0) setsockopt(listen_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        port = bindLoopback(listen_fd);
+    }
+    ~TcpServer() {
+        closeConn();
+        ::close(listen_fd);
+    }
+    void listen() { CHECK(::listen(listen_fd, 8) == 0); }
+    bool accept(int timeout_ms = 2000) {
+        if (conn_fd >= 0) return true;
+        if (!waitReadable(listen_fd, timeout_ms)) return false;
+        conn_fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        return conn_fd >= 0;
+    }
+    void closeConn() {
+        if (conn_fd >= 0) ::close(conn_fd);
+        conn_fd = -1;
+        pending.clear();
+    }
+    // 读到 count 帧或超时，protocol 决定分帧方式
+    std::vector<std::string> receive(NetworkSinkOptions::Protocol protocol, size_t count, int timeout_ms = 2000) {
+        std::vector<std::string> out;
+        if (!accept(timeout_ms)) return out;
+        char buf[65536];
+        while (true) {
+            while (true) {
+                size_t len, head;
+                if (protocol == NetworkSinkOptions::TCP) {
+                    if (pending.size() < 4) break;
+                    uint32_t be;
+                    memcpy(&be, pending.data(), 4);
+                    len = ntohl(be);
+                    head = 4;
+                } else {
+                    size_t sp = pending.find(' ');
+                    if (sp == std::string::npos) break;
+                    len = strtoul(pending.c_str(), nullptr, 10);
+                    head = sp + 1;
+                }
+                if (pending.size() < head + len) break;
+                out.push_back(pending.substr(head, len));
+                pending.erase(0, head + len);
+            }
+            if (out.size() >= count || !waitReadable(conn_fd, timeout_ms)) return out;
+            ssize_t n = ::recv(conn_fd, buf, sizeof(buf), 0);
+            if (n <= 0) return out;
+            pending.append(buf, n);
+        }
+    }
+};
+
+static std::string lines(const std::string &prefix, size_t begin, size_t end) {
+    std::string text;
+    for (size_t i = begin; i < end; ++i) text += prefix + std::to_string(i) + "\n";
+    return text;
+}
+
+static bool endsWith(const std::string &s, const std::string &tail) {
+    return s.size() >= tail.size() && s.compare(s.size() - tail.size(), tail.size(), tail) == 0;
+}
+
+static size_t fileSize(const std::string &path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+// UDP：一次写入的多行各自一个数据报，按顺序到达；PRI 按等级取 severity
+static void testUdpBatch() {
+    UdpServer server;
+    NetworkSinkOptions opt;
+    opt.protocol = NetworkSinkOptions::SYSLOG_UDP;
+    opt.port = server.port;
+    opt.app_name = "udptest";
+    NetworkSink sink(opt);
+    std::string text = lines("udp ", 0, 200);
+    sink.log(text.data(), text.size());
+    auto got = server.receive(200);
+    CHECK(got.size() == 200);
+    for (size_t i = 0; i < got.size(); ++i) {
+        CHECK(got[i].compare(0, 6, "<14>1 ") == 0);         // facility 1 * 8 + informational 6
+        CHECK(got[i].find(" udptest ") != std::string::npos);
+        CHECK(endsWith(got[i], " - - udp " + std::to_string(i)));
+    }
+    sink.logRecord(LogLevel::ERROR, "boom\n", 5);
+    got = server.receive(1);
+    CHECK(got.size() == 1 && got[0].compare(0, 6, "<11>1 ") == 0);
+    CHECK(sink.dropped() == 0);
+}
+
+// UDP：超过 max_datagram 的截断；内核拒绝（EMSGSIZE）的丢弃计数，不影响后面的日志
+static void testUdpOversized() {
+    UdpServer server;
+    std::string huge(100000, 'x');
+    huge += "\n";
+    {
+        NetworkSinkOptions opt;
+        opt.port = server.port;
+        opt.max_datagram = 1000;
+        NetworkSink sink(opt);
+        sink.log(huge.data(), huge.size());
+        sink.log("after\n", 6);
+        auto got = server.receive(2);
+        CHECK(got.size() == 2);
+        CHECK(got[0].size() == 1000);
+        CHECK(endsWith(got[1], "after"));
+        CHECK(sink.truncated() == 1 && sink.dropped() == 0);
+    }
+    {
+        NetworkSinkOptions opt;
+        opt.port = server.port;
+        opt.max_datagram = 200000;          // 比内核上限还大：sendmmsg 返回 EMSGSIZE
+        NetworkSink sink(opt);
+        sink.log(huge.data(), huge.size());
+        sink.log("after\n", 6);
+        auto got = server.receive(1);
+        CHECK(got.size() == 1 && endsWith(got[0], "after"));
+        CHECK(sink.dropped() == 1);
+        CHECK(sink.connected());
+    }
+}
+
+// TCP 两种分帧：一批多行按顺序成帧
+static void testTcpFraming() {
+    for (auto protocol : {NetworkSinkOptions::SYSLOG_TCP, NetworkSinkOptions::TCP}) {
+        TcpServer server;
+        server.listen();
+        NetworkSinkOptions opt;
+        opt.protocol = protocol;
+        opt.port = server.port;
+        NetworkSink sink(opt);
+        std::string text = lines("tcp ", 0, 1000);
+        sink.log(text.data(), text.size());
+        auto got = server.receive(protocol, 1000);
+        CHECK(got.size() == 1000);
+        for (size_t i = 0; i < got.size(); ++i) {
+            std::string line = "tcp " + std::to_string(i);
+            if (protocol == NetworkSinkOptions::TCP) CHECK(got[i] == line);
+            else CHECK(got[i].compare(0, 6, "<14>1 ") == 0 && endsWith(got[i], line));
+        }
+    }
+}
+
+// 连接被拒绝后进入退避：退避期间不重连，日志写入暂存文件；退避结束后连上，按顺序补发
+static void testReconnectBackoff() {
+    std::string spill = LogTest::tempPath("backoff.spill");
+    unlink(spill.c_str());
+    TcpServer server;                       // 已绑定但未 listen：连接被拒绝
+    NetworkSinkOptions opt;
+    opt.protocol = NetworkSinkOptions::TCP;
+    opt.port = server.port;
+    opt.backoff_min_ms = 300;
+    opt.backoff_max_ms = 300;
+    opt.spill_path = spill;
+    NetworkSink sink(opt);
+    std::string first = lines("r ", 0, 10);
+    sink.log(first.data(), first.size());
+    CHECK(!sink.connected());
+    CHECK(fileSize(spill) > 0);
+    uint64_t failed_at = nowMs();
+
+    server.listen();
+    std::string second = lines("r ", 10, 20);
+    sink.log(second.data(), second.size());
+    // 还在退避期间：收集端已经可用也不重连
+    if (nowMs() - failed_at < 250) CHECK(!sink.connected());
+
+    while (nowMs() - failed_at < 350) usleep(10000);
+    sink.flush();
+    CHECK(sink.connected());
+    auto got = server.receive(NetworkSinkOptions::TCP, 20);
+    CHECK(got.size() == 20);
+    for (size_t i = 0; i < got.size(); ++i) CHECK(got[i] == "r " + std::to_string(i));
+    CHECK(fileSize(spill) == 0);            // 全部确认发出后清空
+    CHECK(sink.dropped() == 0);
+
+    // 连接中断后重连，之后的日志照常送达
+    server.closeConn();
+    for (int i = 0; i < 100 && sink.connected(); ++i) {
+        sink.log("probe\n", 6);
+        usleep(5000);
+    }
+    CHECK(!sink.connected());
+    while (nowMs() - failed_at < 2000 && !sink.connected()) {
+        sink.log("again\n", 6);
+        usleep(20000);
+    }
+    CHECK(sink.connected());
+    got = server.receive(NetworkSinkOptions::TCP, 1000, 200);
+    CHECK(std::find(got.begin(), got.end(), "again") != got.end());
+    unlink(spill.c_str());
+}
+
+// 暂存测试用的日志：定长，便于计算每次 loadSpill 读入多少条
+static std::string spillRecord(size_t i) {
+    char id[16];
+    snprintf(id, sizeof(id), "%08zu ", i);
+    return id + std::string(200, 'p');
+}
+
+// 收集端不可用时写入 count 条日志（全部进暂存文件）；然后收集端接受连接但不读，补发到发不动时析构。
+// 返回每条日志是否已经送达（析构前交给内核的部分，关闭连接后照常送达）
+static std::vector<bool> spillThenStall(TcpServer &server, const NetworkSinkOptions &opt, size_t count) {
+    {
+        NetworkSink sink(opt);
+        for (size_t i = 0; i < count; ++i) {
+            std::string line = spillRecord(i) + "\n";
+            sink.log(line.data(), line.size());
+        }
+        CHECK(!sink.connected());
+        CHECK(sink.dropped() == 0);
+    }
+    CHECK(fileSize(opt.spill_path) > 0);
+    server.listen();
+    {
+        NetworkSink sink(opt);
+        sink.flush();
+        CHECK(server.accept());
+    }
+    std::vector<bool> seen(count, false);
+    for (auto &msg : server.receive(NetworkSinkOptions::TCP, count, 200)) seen[strtoul(msg.c_str(), nullptr, 10)] = true;
+    server.closeConn();
+    return seen;
+}
+
+/* 暂存文件补发是“至少一次”：上次运行没发出去的日志在下次启动时补发，读入发送队列但还没发出的日志不能提前从文件里删掉。
+   先量出收集端不读时能送出多少条，再让暂存文件的最后一段（一次 loadSpill 读入的量）正好卡住，这时析构；
+   之后每条日志要么已经送达，要么还在暂存文件里、下次补发。 */
+static void testSpillReplay() {
+    std::string spill = LogTest::tempPath("replay.spill");
+    const int rcvbuf = 4096;                // 接收缓冲区很小，不读就很快发不动
+    NetworkSinkOptions opt;
+    opt.protocol = NetworkSinkOptions::TCP;
+    opt.spill_path = spill;
+    opt.backoff_min_ms = 10;
+    size_t stalled = 0;
+    {
+        unlink(spill.c_str());
+        TcpServer probe(rcvbuf);            // 已绑定但未 listen：连接被拒绝
+        opt.port = probe.port;
+        size_t total = 60000;
+        for (bool sent : spillThenStall(probe, opt, total)) stalled += sent;
+        CHECK(stalled > 0 && stalled < total);
+    }
+    size_t per_load = (64 * 1024 + spillRecord(0).size() - 1) / spillRecord(0).size();
+    size_t count = (stalled / per_load + 1) * per_load;
+
+    unlink(spill.c_str());
+    TcpServer server(rcvbuf);
+    opt.port = server.port;
+    std::vector<bool> seen = spillThenStall(server, opt, count);
+    if (fileSize(spill) == 0)
+        for (size_t i = 0; i < count; ++i) CHECK(seen[i]);
+
+    // 下一次运行补发暂存文件中剩下的全部（已经送达的可能重复），按顺序
+    {
+        NetworkSink sink(opt);
+        std::vector<std::string> got;
+        uint64_t begin = nowMs();
+        while (fileSize(spill) > 0 && nowMs() - begin < 5000) {
+            sink.flush();
+            auto part = server.receive(NetworkSinkOptions::TCP, count, 20);
+            got.insert(got.end(), part.begin(), part.end());
+        }
+        auto part = server.receive(NetworkSinkOptions::TCP, count, 200);
+        got.insert(got.end(), part.begin(), part.end());
+        CHECK(fileSize(spill) == 0);
+        for (size_t i = 0; i < got.size(); ++i) {
+            size_t id = strtoul(got[i].c_str(), nullptr, 10);
+            CHECK(id < count && got[i] == spillRecord(id));
+            CHECK(i == 0 || id == strtoul(got[i - 1].c_str(), nullptr, 10) + 1);
+            seen[id] = true;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) CHECK(seen[i]);
+    unlink(spill.c_str());
+}
+
+// 收集端不读时，每次 log()/flush() 最多阻塞 max_block_ms；异步日志器的工作线程（threadEntry）因此不会被卡住
+static void testBlockingBound() {
+    TcpServer server(4096);
+    server.listen();
+    NetworkSinkOptions opt;
+    opt.protocol = NetworkSinkOptions::TCP;
+    opt.port = server.port;
+    opt.max_block_ms = 30;
+    auto sink = std::make_shared<NetworkSink>(opt);
+    std::string text = lines(std::string(1000, 'b') + " ", 0, 8000);    // 约 8M，远超过套接字缓冲区
+    uint64_t begin = nowMs();
+    sink->log(text.data(), text.size());
+    uint64_t took = nowMs() - begin;
+    CHECK(took >= 25 && took < 300);
+    CHECK(server.accept());
+
+    auto logger = LoggerFactory::createAsynchLogger("net-bound", LogLevel::DEBUG, "%m%n", {sink});
+    std::string msg(1000, 'a');
+    for (int round = 0; round < 5; ++round) {
+        for (int i = 0; i < 200; ++i) logger->info(__FILE__, __LINE__, msg);
+        begin = nowMs();
+        logger->flush();
+        took = nowMs() - begin;
+        CHECK(took < 500);
+    }
+    begin = nowMs();
+    logger.reset();
+    sink.reset();
+    CHECK(nowMs() - begin < 500);
+}
+
+int main() {
+    testUdpBatch();
+    testUdpOversized();
+    testTcpFraming();
+    testReconnectBackoff();
+    testSpillReplay();
+    testBlockingBound();
+    printf("network_sink_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,82 @@
+// ordered_sink_test.cpp - 按时间重排的落地方向（OrderedSink）
+//   分几批乱序到达的记录按时间戳写出；窗口内的记录在窗口到期前不写出；
+//   长时间停留在窗口中的记录跨多轮后只写出一次，且整体按时间有序。
+
+#include "../logs/router.hpp"
+#include "check.hpp"
+
+using namespace MySpace;
+
+// 按到达顺序记下目标收到的记录
+class CaptureSink : public LogSink {
+    public:
+        void log(const char *data, size_t len) override {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _lines.emplace_back(data, len);
+            _ts.push_back(0);
+        }
+        void logRecords(Buffer &buf, LogLevel::value) override {
+            std::unique_lock<std::mutex> lock(_mutex);
+            for (const RecordView &rec : buf.records()) {
+                _lines.emplace_back(rec.data, rec.len);
+                _ts.push_back(rec.ts_ns);
+            }
+        }
+        std::vector<std::string> lines() { std::unique_lock<std::mutex> lock(_mutex); return _lines; }
+        std::vector<uint64_t> stamps() { std::unique_lock<std::mutex> lock(_mutex); return _ts; }
+    private:
+        std::mutex _mutex;
+        std::vector<std::string> _lines;
+        std::vector<uint64_t> _ts;
+};
+
+static void feed(OrderedSink &sink, std::initializer_list<std::pair<const char *, uint64_t>> records) {
+    Buffer buf;
+    for (auto &r : records) buf.push(r.first, strlen(r.first), LogLevel::INFO, 1, r.second);
+    sink.writeBatch(buf);
+}
+
+static void testReorder() {
+    auto target = std::make_shared<CaptureSink>();
+    OrderedSink sink(target, 1000);
+    uint64_t base = Buffer::nowNs();
+    feed(sink, {{"d", base + 3}, {"b", base + 1}});
+    feed(sink, {{"c", base + 2}, {"a", base + 0}, {"c2", base + 2}});
+    // 窗口 1 秒，还没到期
+    usleep(20 * 1000);
+    CHECK(target->lines().empty());
+    sink.flush();
+    CHECK((target->lines() == std::vector<std::string>{"a", "b", "c", "c2", "d"}));
+    CHECK(sink.late() == 0);
+}
+
+// 每毫秒到达一批，窗口 100ms：记录在窗口中停留很多轮
+static void testLongWindow() {
+    auto target = std::make_shared<CaptureSink>();
+    OrderedSink sink(target, 100);
+    const int batches = 500;
+    for (int i = 0; i < batches; ++i) {
+        uint64_t now = Buffer::nowNs();
+        // 第二条比第一条早 5ms，跨批次乱序
+        std::string first = "r" + std::to_string(2 * i), second = "r" + std::to_string(2 * i + 1);
+        feed(sink, {{first.c_str(), now}, {second.c_str(), now - 5000000}});
+        usleep(1000);
+    }
+    sink.flush();
+    std::vector<std::string> lines = target->lines();
+    std::vector<uint64_t> stamps = target->stamps();
+    CHECK(lines.size() == 2 * batches);
+    std::vector<int> seen(2 * batches, 0);
+    for (auto &line : lines) seen[std::stoi(line.substr(1))]++;
+    for (int n : seen) CHECK(n == 1);
+    CHECK(std::is_sorted(stamps.begin(), stamps.end()));
+    CHECK(sink.late() == 0);
+}
+
+int main() {
+    alarm(60);
+    testReorder();
+    testLongWindow();
+    printf("ordered_sink_test: ok\n");
+    return 0;
+}
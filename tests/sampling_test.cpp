@@ -0,0 +1,49 @@
+// sampling_test.cpp - 日志采样（Logger::setSampling）
+//   等级不是 DEBUG~FATAL 时拒绝设置；每个日志器在每个线程中有自己的计数器，
+//   编号按槽位数取模相同的两个日志器在同一线程中交替记录时互不影响。
+
+#include "../logs/logger.hpp"
+#include "check.hpp"
+
+using namespace MySpace;
+
+class CountingSink : public LogSink {
+    public:
+        void log(const char *, size_t) override { _lines++; }
+        size_t lines() const { return _lines; }
+    private:
+        size_t _lines = 0;
+};
+
+int main() {
+    alarm(60);
+    auto first_sink = std::make_shared<CountingSink>();
+    auto first = LoggerFactory::createSynchLogger("sampling-first", LogLevel::DEBUG, "%m%n", {first_sink});
+    CHECK(!first->setSampling(LogLevel::OFF, 2));
+    CHECK(!first->setSampling((LogLevel::value)100, 2));
+    CHECK(first->setSampling(LogLevel::INFO, 2));
+
+    // 一直创建到编号与 first 相差 64 的整数倍（按编号取模分槽时两者会共用计数器）
+    std::vector<std::shared_ptr<Logger>> others;
+    std::shared_ptr<CountingSink> second_sink;
+    std::shared_ptr<Logger> second;
+    while (!second || second->id() % 64 != first->id() % 64) {
+        if (second) others.push_back(second);
+        second_sink = std::make_shared<CountingSink>();
+        second = LoggerFactory::createSynchLogger("sampling-" + std::to_string(others.size()), LogLevel::DEBUG, "%m%n", {second_sink});
+    }
+    CHECK(second->setSampling(LogLevel::INFO, 2));
+
+    // 交替记录：每个日志器各自每 2 条取 1 条（共用计数器时一个全保留、另一个全丢弃）
+    for (int i = 0; i < 300; ++i) {
+        first->info(__FILE__, __LINE__, "a");
+        second->info(__FILE__, __LINE__, "b");
+    }
+    CHECK(first_sink->lines() == 150);
+    CHECK(second_sink->lines() == 150);
+    // 其他等级不受影响
+    first->warn(__FILE__, __LINE__, "w");
+    CHECK(first_sink->lines() == 151);
+    printf("sampling_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,60 @@
+// sink_stats_test.cpp - 落地方向统计（LogSink::stats）
+//   落地方向设了等级时，字节数只计实际交给 log()/logRecord() 的部分，同步和异步日志器一致；
+//   经路由（RouteSink）转发的流量按路由的等级计入目标落地方向自己的统计。
+
+#include "../logs/logger.hpp"
+#include "../logs/router.hpp"
+#include "check.hpp"
+
+using namespace MySpace;
+
+// 记录实际收到的字节数；levelAware 时走 logRecord()
+class CountingSink : public LogSink {
+    public:
+        explicit CountingSink(bool level_aware) : _level_aware(level_aware) {}
+        void log(const char *, size_t len) override { _received += len; }
+        bool levelAware() const override { return _level_aware; }
+        size_t received() const { return _received; }
+    private:
+        bool _level_aware;
+        size_t _received = 0;
+};
+
+static void run(bool asynch, bool level_aware) {
+    auto all = std::make_shared<CountingSink>(level_aware);
+    auto warn = std::make_shared<CountingSink>(level_aware);
+    warn->setLevel(LogLevel::WARN);
+    auto routed = std::make_shared<CountingSink>(level_aware);
+    auto route = std::make_shared<RouteSink>(routed, LogLevel::WARN);
+    std::string name = std::string(asynch ? "stats-asynch" : "stats-synch") + (level_aware ? "-aware" : "");
+    auto logger = asynch
+        ? LoggerFactory::createAsynchLogger(name, LogLevel::DEBUG, "%p %m%n", {all, warn, route})
+        : LoggerFactory::createSynchLogger(name, LogLevel::DEBUG, "%p %m%n", {all, warn, route});
+    size_t warn_bytes = 0, all_bytes = 0;
+    for (int i = 0; i < 1000; ++i) {
+        std::string msg = std::string(i % 50, 'x');
+        LogLevel::value level = (LogLevel::value)(i % 4);
+        logger->logAt(level, __FILE__, __LINE__, msg);
+        size_t len = LogLevel::toString(level).size() + 1 + msg.size() + 1;
+        all_bytes += len;
+        if (level >= LogLevel::WARN) warn_bytes += len;
+    }
+    CHECK(logger->flush());
+    LoggerStatsSnapshot s = logger->stats();
+    CHECK(s.sinks.size() == 3);
+    CHECK(all->received() == all_bytes);
+    CHECK(s.sinks[0].bytes == all_bytes);
+    CHECK(warn->received() == warn_bytes);
+    CHECK(s.sinks[1].bytes == warn_bytes);
+    CHECK(routed->received() == warn_bytes);
+    CHECK(s.sinks[2].bytes == warn_bytes);
+    CHECK(routed->stats().bytes == warn_bytes);
+}
+
+int main() {
+    alarm(60);
+    for (bool asynch : {false, true})
+        for (bool level_aware : {false, true}) run(asynch, level_aware);
+    printf("sink_stats_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,126 @@
+// stdout_sink_test.cpp - StdoutSink 的定时写出：所有实例共用一个线程，空闲时缓冲区中的内容按间隔写出，fork 后子进程中照常工作；
+//   多个线程不加锁同时写（concurrentSafe）时每行完整，同一线程的行保持顺序
+
+#include "../logs/sink.hpp"
+#include "check.hpp"
+#include <dirent.h>
+#include <sys/wait.h>
+#include <sstream>
+#include <thread>
+
+using namespace MySpace;
+
+static size_t threadCount() {
+    size_t n = 0;
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) return 0;
+    while (struct dirent *e = readdir(dir))
+        if (e->d_name[0] != '.') n++;
+    closedir(dir);
+    return n;
+}
+
+// 等到文件内容里出现 needle，超时返回 false
+static bool waitFor(const std::string &path, const std::string &needle, int timeout_ms) {
+    for (int waited = 0; waited < timeout_ms; waited += 10) {
+        if (LogTest::readFile(path).find(needle) != std::string::npos) return true;
+        usleep(10000);
+    }
+    return false;
+}
+
+// 8 个线程同时写，暂存区很小（频繁由写线程自己写出），中途线程退出、定时写出和 flush 交替发生
+static void testConcurrentWriters() {
+    const size_t writers = 8, count = 20000;
+    std::string path = LogTest::tempPath("stdout_concurrent.log");
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CHECK(fd >= 0);
+    {
+        StdoutSink sink(fd, false, 1024, 1);
+        CHECK(sink.concurrentSafe());
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < writers; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = 0; i < count; ++i) {
+                    std::string line = std::to_string(t) + " " + std::to_string(i) + " " + std::string(i % 64, 'x') + "\n";
+                    sink.log(line.data(), line.size());
+                    if (i % 5000 == 0) sink.flush();
+                }
+            });
+        }
+        for (auto &th : threads) th.join();
+        sink.flush();
+    }
+    ::close(fd);
+    std::istringstream in(LogTest::readFile(path));
+    std::string line;
+    std::vector<long> last(writers, -1);
+    size_t lines = 0;
+    while (std::getline(in, line)) {
+        size_t t = 0, i = 0;
+        int used = 0;
+        CHECK(sscanf(line.c_str(), "%zu %zu %n", &t, &i, &used) == 2);
+        CHECK(t < writers && (long)i == last[t] + 1);
+        CHECK(line.size() - used == i % 64);
+        last[t] = i;
+        lines++;
+    }
+    CHECK(lines == writers * count);
+    unlink(path.c_str());
+}
+
+int main() {
+    testConcurrentWriters();
+    const size_t sinks_count = 32;
+    std::vector<std::string> paths;
+    std::vector<int> fds;
+    for (size_t i = 0; i < sinks_count; ++i) {
+        paths.push_back(LogTest::tempPath("stdout_" + std::to_string(i) + ".log"));
+        fds.push_back(::open(paths.back().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        CHECK(fds.back() >= 0);
+    }
+
+    // 第一个实例启动共用的定时写出线程，之后的实例不再增加线程
+    std::vector<std::unique_ptr<StdoutSink>> sinks;
+    sinks.emplace_back(new StdoutSink(fds[0], false, 64 * 1024, 20));
+    usleep(10000);
+    size_t threads = threadCount();
+    for (size_t i = 1; i < sinks_count; ++i)
+        sinks.emplace_back(new StdoutSink(fds[i], false, 64 * 1024, 20 + i));
+    CHECK(threadCount() == threads);
+
+    // 不调用 flush：空闲后按各自的间隔写出
+    for (size_t i = 0; i < sinks_count; ++i) {
+        std::string line = "sink " + std::to_string(i) + "\n";
+        sinks[i]->log(line.data(), line.size());
+    }
+    for (size_t i = 0; i < sinks_count; ++i) CHECK(waitFor(paths[i], "sink " + std::to_string(i) + "\n", 2000));
+
+    // 析构一部分时另一部分照常定时写出
+    sinks.resize(sinks_count / 2);
+    sinks[0]->log("after resize\n", 13);
+    CHECK(waitFor(paths[0], "after resize\n", 2000));
+
+    // fork 后子进程里重新启动共用线程，缓冲区中父进程的内容不重复写出
+    sinks[1]->log("before fork\n", 12);
+    pid_t pid = fork();
+    if (pid == 0) {
+        sinks[1]->log("child\n", 6);
+        bool ok = waitFor(paths[1], "child\n", 2000);
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(waitFor(paths[1], "before fork\n", 2000));
+    std::string text = LogTest::readFile(paths[1]);
+    CHECK(LogTest::countOf(text, "before fork\n") == 1);
+
+    sinks.clear();
+    for (size_t i = 0; i < sinks_count; ++i) {
+        ::close(fds[i]);
+        unlink(paths[i].c_str());
+    }
+    printf("stdout_sink_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,46 @@
+// thread_info_test.cpp - 线程标识（ThreadInfo）
+//   先记录过日志的线程 fork 后，子进程中的 %t 是子进程自己的线程号，不是父进程缓存下来的。
+
+#include "../logs/logger.hpp"
+#include "check.hpp"
+#include <sys/wait.h>
+
+using namespace MySpace;
+
+static std::string tidOf(uint32_t tid) { return std::to_string(tid); }
+
+int main() {
+    alarm(60);
+    std::string path = LogTest::tempPath("thread_info.log");
+    uint32_t parent = (uint32_t)::syscall(SYS_gettid);
+    CHECK(ThreadInfo::current().tid() == parent);
+    auto logger = LoggerFactory::createSynchLogger("thread-info", LogLevel::DEBUG, "%t %m%n"
+        , {std::make_shared<FileSink>(path)});
+    logger->info(__FILE__, __LINE__, "parent");
+    logger->flush();
+
+    for (int round = 0; round < 2; ++round) {
+        pid_t pid = fork();
+        CHECK(pid >= 0);
+        if (pid == 0) {
+            uint32_t self = (uint32_t)::syscall(SYS_gettid);
+            const ThreadInfo &info = ThreadInfo::current();
+            bool ok = info.tid() == self && std::string(info.tidText(), info.tidTextLen()) == tidOf(self);
+            logger->info(__FILE__, __LINE__, "child");
+            logger->flush();
+            std::_Exit(ok ? 0 : 3);
+        }
+        int status = 0;
+        CHECK(waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        CHECK(LogTest::readFile(path).find(tidOf((uint32_t)pid) + " child\n") != std::string::npos);
+    }
+    // 父进程自己的缓存不受影响
+    CHECK(ThreadInfo::current().tid() == parent);
+    std::string text = LogTest::readFile(path);
+    CHECK(text.find(tidOf(parent) + " parent\n") == 0);
+    CHECK(LogTest::countOf(text, tidOf(parent) + " child") == 0);
+    unlink(path.c_str());
+    printf("thread_info_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,423 @@
+// log_query.cpp - 按时间范围、等级、子串查询日志文件
+// 有旁路索引（RollBySizeSink 的 index_block 参数，见 logs/index.hpp）的文件只扫描时间范围和等级可能匹配的段，
+// 没有索引的文件（或索引之后还没登记的尾部）整段扫描。文件用 mmap 读取，各段分给多个线程并行扫描，
+// 输出按 文件名、文件内偏移 的顺序排列，和逐个 grep 的结果顺序一致。
+//
+// 索引只用来跳过整段；时间和等级按 --format/--pattern（与写日志时的格式化器一致）从每行记录的对应位置解析后逐行判断，
+// 消息正文里出现的等级名或时间不会被误认。时间格式里没有日期时（默认格式只有 %H:%M:%S），日期取文件修改时间的日期。
+// 指定了时间或等级过滤时，按格式解析不出时间/等级的行（例如多行消息的后续行）不输出。
+//
+// 用法：log_query [--from 时间] [--to 时间] [--level 等级] [--grep 子串] [--format pattern|json|logfmt] [--pattern 格式]
+//                 [--threads N] [--count] 文件或目录...
+//       时间为 "YYYY-MM-DD HH:MM:SS"（本地时间）或 Unix 秒
+
+#include "../logs/index.hpp"
+#include "../logs/format.hpp"
+#include "../logs/simd.hpp"
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace MySpace;
+
+struct Query {
+    uint64_t from_ns = 0;
+    uint64_t to_ns = UINT64_MAX;
+    LogLevel::value level = LogLevel::DEBUG;
+    std::string grep;
+    bool count_only = false;
+    bool filter_time = false;               // 指定了 --from/--to
+};
+
+/* 按格式化器的输出格式从一行记录中取出时间和等级：
+   pattern 格式按 %d{...} 和 %p 在格式串中的位置解析，其余字段跳到下一段原始字符；
+   json/logfmt 格式的前两个字段固定是 time 和 level */
+class RecordParser {
+    public:
+        RecordParser(FormatMode mode, const std::string &pattern) {
+            if (mode == FORMAT_JSON) {
+                _items = { Item{LITERAL, "{\"time\":\""}, Item{TIME, pattern}, Item{LITERAL, "\",\"level\":\""}, Item{LEVEL, ""} };
+            } else if (mode == FORMAT_LOGFMT) {
+                // 时间里有空格等字符时 logfmt 会加引号
+                _items = { Item{LITERAL, "time="}, Item{QUOTE, ""}, Item{TIME, pattern}, Item{QUOTE, ""}
+                    , Item{LITERAL, " level="}, Item{LEVEL, ""} };
+            } else {
+                parsePattern(pattern);
+            }
+            for (const Item &item : _items) {
+                if (item.kind == TIME) _has_time = true;
+                if (item.kind == LEVEL) _has_level = true;
+            }
+        }
+        bool valid() const { return _valid; }
+        /* 解析一行；base 是时间格式里没有日期时使用的日期（当天 0 点的本地时间）。
+           格式里有对应字段却解析失败时返回 false */
+        bool parse(const char *line, size_t len, time_t base, uint64_t &ts_ns, bool &has_time
+            , LogLevel::value &level, bool &has_level) const {
+            const char *pos = line, *end = line + len;
+            has_time = has_level = false;
+            for (size_t i = 0; i < _items.size(); ++i) {
+                const Item &item = _items[i];
+                switch (item.kind) {
+                    case LITERAL:
+                        if ((size_t)(end - pos) < item.text.size() || memcmp(pos, item.text.data(), item.text.size()) != 0)
+                            return false;
+                        pos += item.text.size();
+                        break;
+                    case QUOTE:
+                        if (pos < end && *pos == '"') pos++;
+                        break;
+                    case TIME: {
+                        char buf[64];
+                        size_t n = std::min<size_t>(end - pos, sizeof(buf) - 1);
+                        memcpy(buf, pos, n);
+                        buf[n] = '\0';
+                        struct tm t;
+                        localtime_r(&base, &t);
+                        const char *rest = strptime(buf, item.text.c_str(), &t);
+                        if (!rest) return false;
+                        t.tm_isdst = -1;
+                        time_t secs = mktime(&t);
+                        if (secs < 0) return false;
+                        ts_ns = (uint64_t)secs * 1000000000ull;
+                        has_time = true;
+                        pos += rest - buf;
+                        break;
+                    }
+                    case LEVEL: {
+                        int l = LogLevel::DEBUG;
+                        for (; l < LogLevel::OFF; ++l) {
+                            const char *name = LogLevel::toCString((LogLevel::value)l);
+                            size_t n = strlen(name);
+                            if ((size_t)(end - pos) >= n && memcmp(pos, name, n) == 0) {
+                                pos += n;
+                                break;
+                            }
+                        }
+                        if (l == LogLevel::OFF) return false;
+                        level = (LogLevel::value)l;
+                        has_level = true;
+                        break;
+                    }
+                    case SKIP: {
+                        // 跳到下一段原始字符；其后没有原始字符时已经不需要再解析
+                        if (i + 1 == _items.size() || _items[i + 1].kind != LITERAL) return true;
+                        const std::string &next = _items[i + 1].text;
+                        const char *hit = (const char *)memmem(pos, end - pos, next.data(), next.size());
+                        if (!hit) return false;
+                        pos = hit;
+                        break;
+                    }
+                }
+                if (has_time == _has_time && has_level == _has_level) return true;
+            }
+            return true;
+        }
+        bool hasTime() const { return _has_time; }
+        bool hasLevel() const { return _has_level; }
+    private:
+        enum Kind { LITERAL, QUOTE, TIME, LEVEL, SKIP };
+        struct Item {
+            Kind kind;
+            std::string text;       // 原始字符，或时间格式
+        };
+        // 与 Formatter::parsePattern 相同的语法：%% 为 %，%x{子规则}
+        void parsePattern(const std::string &pattern) {
+            std::string literal;
+            auto flush = [&]() {
+                if (literal.empty()) return;
+                if (!_items.empty() && _items.back().kind == LITERAL) _items.back().text += literal;
+                else _items.push_back(Item{LITERAL, literal});
+                literal.clear();
+            };
+            for (size_t pos = 0; pos < pattern.size(); ) {
+                if (pattern[pos] != '%') { literal.push_back(pattern[pos++]); continue; }
+                if (pos + 1 < pattern.size() && pattern[pos + 1] == '%') { literal.push_back('%'); pos += 2; continue; }
+                if (pos + 1 == pattern.size()) { _valid = false; return; }
+                char key = pattern[pos + 1];
+                pos += 2;
+                std::string sub;
+                if (pos < pattern.size() && pattern[pos] == '{') {
+                    size_t close = pattern.find('}', pos);
+                    if (close == std::string::npos) { _valid = false; return; }
+                    sub = pattern.substr(pos + 1, close - pos - 1);
+                    pos = close + 1;
+                }
+                if (key == 'T') { literal.push_back('\t'); continue; }
+                if (key == 'n') { literal.push_back('\n'); continue; }
+                flush();
+                if (key == 'd' && !sub.empty()) _items.push_back(Item{TIME, sub});
+                else if (key == 'p') _items.push_back(Item{LEVEL, ""});
+                else if (key == 'd') continue;   // 空的时间格式不输出任何内容
+                else if (_items.empty() || _items.back().kind != SKIP) _items.push_back(Item{SKIP, ""});
+            }
+            flush();
+        }
+    private:
+        std::vector<Item> _items;
+        bool _valid = true;
+        bool _has_time = false;
+        bool _has_level = false;
+};
+
+// 一个文件的 mmap 映射
+struct MappedFile {
+    std::string path;
+    const char *data = nullptr;
+    size_t size = 0;
+    time_t base_date = 0;   // 文件修改时间当天 0 点，时间格式里没有日期时使用
+};
+
+// 一个扫描单元：某个文件的一段
+struct Unit {
+    size_t file;
+    size_t begin;
+    size_t end;
+    std::string out;        // 匹配的行
+    size_t matches = 0;
+};
+
+static bool parseTime(const std::string &text, uint64_t &ns) {
+    char *end = nullptr;
+    unsigned long long secs = strtoull(text.c_str(), &end, 10);
+    if (end && *end == '\0') {
+        ns = secs * 1000000000ull;
+        return true;
+    }
+    struct tm t;
+    memset(&t, 0, sizeof(t));
+    const char *rest = strptime(text.c_str(), "%Y-%m-%d %H:%M:%S", &t);
+    if (!rest || *rest != '\0') return false;
+    t.tm_isdst = -1;
+    time_t secs_t = mktime(&t);
+    if (secs_t < 0) return false;
+    ns = (uint64_t)secs_t * 1000000000ull;
+    return true;
+}
+
+// 收集参数中的文件；目录取其中的普通文件（跳过 .idx）
+static void collectFiles(const std::string &path, std::vector<std::string> &files) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        fprintf(stderr, "无法访问: %s\n", path.c_str());
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        files.push_back(path);
+        return;
+    }
+    DIR *dir = opendir(path.c_str());
+    if (!dir) return;
+    while (struct dirent *ent = readdir(dir)) {
+        std::string name = ent->d_name;
+        if (name == "." || name == "..") continue;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".idx") == 0) continue;
+        std::string full = path + (path.back() == '/' ? "" : "/") + name;
+        if (stat(full.c_str(), &st) == 0 && S_ISREG(st.st_mode)) files.push_back(full);
+    }
+    closedir(dir);
+}
+
+// 这一行的时间和等级是否满足查询：从记录中对应的位置解析，不在整行里查找
+static bool lineMatches(const char *line, size_t len, const MappedFile &file, const Query &q, const RecordParser &parser) {
+    bool by_level = q.level > LogLevel::DEBUG;
+    if (!by_level && !q.filter_time) return true;
+    uint64_t ts_ns = 0;
+    bool has_time = false, has_level = false;
+    LogLevel::value level = LogLevel::DEBUG;
+    if (!parser.parse(line, len, file.base_date, ts_ns, has_time, level, has_level)) return false;
+    if (by_level && (!has_level || level < q.level)) return false;
+    if (q.filter_time && (!has_time || ts_ns < q.from_ns || ts_ns > q.to_ns)) return false;
+    return true;
+}
+
+static void scanUnit(const MappedFile &file, Unit &unit, const Query &q, const RecordParser &parser) {
+    Simd::forEachLine(file.data + unit.begin, unit.end - unit.begin, [&](const char *line, size_t len) {
+        if (len == 0) return;
+        if (!q.grep.empty() && !memmem(line, len, q.grep.data(), q.grep.size())) return;
+        if (!lineMatches(line, len, file, q, parser)) return;
+        unit.matches++;
+        if (!q.count_only) {
+            unit.out.append(line, len);
+            unit.out.push_back('\n');
+        }
+    });
+}
+
+// 把区间 [begin, end) 切成不超过 max_len 的扫描单元，切点对齐到行首
+static void addUnits(std::vector<Unit> &units, size_t file, const MappedFile &mf, size_t begin, size_t end, size_t max_len) {
+    while (begin < end) {
+        size_t cut = end;
+        if (end - begin > max_len) {
+            cut = begin + max_len;
+            cut += Simd::findByte(mf.data + cut, end - cut, '\n');
+            if (cut < end) cut++;
+        }
+        Unit unit;
+        unit.file = file;
+        unit.begin = begin;
+        unit.end = cut;
+        units.push_back(std::move(unit));
+        begin = cut;
+    }
+}
+
+// 按索引挑出需要扫描的段；返回跳过的字节数
+static size_t planFile(std::vector<Unit> &units, size_t file, const MappedFile &mf, const Query &q, size_t max_len) {
+    std::vector<IndexEntry> entries;
+    if (!IndexWriter::read(mf.path, entries)) {
+        addUnits(units, file, mf, 0, mf.size, max_len);
+        return 0;
+    }
+    uint32_t want_mask = 0;
+    for (int l = q.level; l < LogLevel::OFF; ++l) want_mask |= 1u << l;
+    size_t skipped = 0, indexed_end = 0;
+    size_t run_begin = 0, run_end = 0;   // 相邻的需要扫描的段合并
+    for (const IndexEntry &e : entries) {
+        if (e.offset >= mf.size) break;
+        size_t end = (size_t)std::min<uint64_t>(e.offset + e.length, mf.size);
+        indexed_end = std::max(indexed_end, end);
+        bool hit = e.max_ts_ns >= q.from_ns && e.min_ts_ns <= q.to_ns && (e.level_mask & want_mask);
+        if (!hit) {
+            skipped += end - e.offset;
+            continue;
+        }
+        if (run_end != e.offset) {
+            addUnits(units, file, mf, run_begin, run_end, max_len);
+            run_begin = e.offset;
+        }
+        run_end = end;
+    }
+    addUnits(units, file, mf, run_begin, run_end, max_len);
+    // 索引之后还没登记的尾部（最后一段尚未写出索引，或进程崩溃）
+    addUnits(units, file, mf, indexed_end, mf.size, max_len);
+    return skipped;
+}
+
+static void usage() {
+    fprintf(stderr, "用法：log_query [--from 时间] [--to 时间] [--level 等级] [--grep 子串] [--format pattern|json|logfmt] [--pattern 格式]\n"
+                    "                 [--threads N] [--count] 文件或目录...\n"
+                    "      时间为 \"YYYY-MM-DD HH:MM:SS\"（本地时间）或 Unix 秒\n"
+                    "      --pattern 为写日志时的格式化字符串（json/logfmt 时为时间格式），默认与 Formatter 的默认值相同\n");
+}
+
+int main(int argc, char *argv[]) {
+    Query q;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> files;
+    FormatMode mode = FORMAT_PATTERN;
+    std::string pattern;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_val = i + 1 < argc;
+        if (arg == "--count") { q.count_only = true; continue; }
+        if (arg == "-h" || arg == "--help") { usage(); return 0; }
+        if (arg.compare(0, 2, "--") == 0 && !has_val) { usage(); return 2; }
+        if (arg == "--from" || arg == "--to") {
+            uint64_t &ns = arg == "--from" ? q.from_ns : q.to_ns;
+            if (!parseTime(argv[++i], ns)) { fprintf(stderr, "无法解析的时间: %s\n", argv[i]); return 2; }
+            if (arg == "--to") ns += 999999999ull;   // 包含这一秒
+            q.filter_time = true;
+        } else if (arg == "--format") {
+            std::string format = argv[++i];
+            if (format == "json") mode = FORMAT_JSON;
+            else if (format == "logfmt") mode = FORMAT_LOGFMT;
+            else if (format != "pattern") { fprintf(stderr, "未知的输出格式: %s\n", argv[i]); return 2; }
+        } else if (arg == "--pattern") {
+            pattern = argv[++i];
+        } else if (arg == "--level") {
+            if (!LogLevel::fromString(argv[++i], q.level)) { fprintf(stderr, "未知的日志等级: %s\n", argv[i]); return 2; }
+        } else if (arg == "--grep") {
+            q.grep = argv[++i];
+        } else if (arg == "--threads") {
+            threads = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+        } else {
+            collectFiles(arg, files);
+        }
+    }
+    if (files.empty()) { usage(); return 2; }
+    // 默认格式与 Formatter 的默认值一致
+    if (pattern.empty()) pattern = mode == FORMAT_PATTERN ? Formatter().pattern() : Formatter(mode).pattern();
+    RecordParser parser(mode, pattern);
+    if (!parser.valid()) { fprintf(stderr, "无法解析的格式: %s\n", pattern.c_str()); return 2; }
+    if (q.level > LogLevel::DEBUG && !parser.hasLevel()) { fprintf(stderr, "格式中没有等级（%%p），无法按等级过滤\n"); return 2; }
+    if (q.filter_time && !parser.hasTime()) { fprintf(stderr, "格式中没有时间（%%d{...}），无法按时间过滤\n"); return 2; }
+    std::sort(files.begin(), files.end());
+    uint64_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // 1、 映射文件并按索引规划扫描单元
+    std::vector<MappedFile> mapped(files.size());
+    std::vector<Unit> units;
+    size_t total = 0, skipped = 0;
+    const size_t max_unit = 4 * 1024 * 1024;   // 大段切成 4M 的单元，线程间分配更均匀
+    for (size_t f = 0; f < files.size(); ++f) {
+        MappedFile &mf = mapped[f];
+        mf.path = files[f];
+        int fd = ::open(mf.path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            fprintf(stderr, "打开失败: %s\n", mf.path.c_str());
+            if (fd >= 0) ::close(fd);
+            continue;
+        }
+        mf.size = st.st_size;
+        struct tm day;
+        localtime_r(&st.st_mtime, &day);
+        day.tm_hour = day.tm_min = day.tm_sec = 0;
+        day.tm_isdst = -1;
+        mf.base_date = mktime(&day);
+        if (mf.size > 0) {
+            void *p = mmap(nullptr, mf.size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                fprintf(stderr, "映射失败: %s\n", mf.path.c_str());
+                mf.size = 0;
+            } else {
+                mf.data = static_cast<const char *>(p);
+                madvise(p, mf.size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+        total += mf.size;
+        if (mf.size > 0) skipped += planFile(units, f, mf, q, max_unit);
+    }
+
+    // 2、 多线程扫描
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < std::min(threads, std::max<size_t>(units.size(), 1)); ++t) {
+        workers.emplace_back([&]() {
+            for (size_t i; (i = next++) < units.size(); )
+                scanUnit(mapped[units[i].file], units[i], q, parser);
+        });
+    }
+    for (auto &w : workers) w.join();
+
+    // 3、 按顺序输出
+    size_t matches = 0;
+    for (Unit &unit : units) {
+        matches += unit.matches;
+        if (!q.count_only) fwrite(unit.out.data(), 1, unit.out.size(), stdout);
+    }
+    if (q.count_only) printf("%zu\n", matches);
+    for (MappedFile &mf : mapped)
+        if (mf.data) munmap(const_cast<char *>(mf.data), mf.size);
+
+    uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() - start;
+    fprintf(stderr, "[log_query] files=%zu bytes=%zu skipped_by_index=%zu matches=%zu threads=%zu time=%.1fms\n",
+        files.size(), total, skipped, matches, workers.size(), elapsed / 1e6);
+    return 0;
+}